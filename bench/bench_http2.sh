@@ -0,0 +1,75 @@
+#!/bin/sh
+# Compares the HTTP/1.1 and HTTP/2 (h2c) paths under a many-small-assets load.
+# Usage: ./bench/bench_http2.sh [asset_count] [rounds]
+# Needs curl with HTTP/2 support. Build the server first with ./build.sh release.
+
+ASSET_COUNT=${1:-200}
+ROUNDS=${2:-5}
+PORT=${PORT:-9191}
+SERVER_BINARY=${SERVER_BINARY:-./k15_server_manager}
+BENCH_ROOT=$(mktemp -d)
+
+cleanup()
+{
+	[ -n "$SERVER_PID" ] && kill $SERVER_PID 2>/dev/null
+	rm -rf "$BENCH_ROOT"
+}
+trap cleanup EXIT
+
+if ! curl --version | grep -q HTTP2; then
+	echo "curl without HTTP/2 support, can't run the benchmark."
+	exit 1
+fi
+
+# dashboard-like assets between 512 bytes and 4 KiB
+mkdir -p "$BENCH_ROOT/assets"
+i=0
+while [ $i -lt $ASSET_COUNT ]; do
+	head -c $(( 512 + (i * 131) % 3584 )) /dev/urandom > "$BENCH_ROOT/assets/asset_$i.js"
+	i=$((i + 1))
+done
+
+URL_FILE="$BENCH_ROOT/urls.txt"
+i=0
+while [ $i -lt $ASSET_COUNT ]; do
+	echo "url = \"http://127.0.0.1:$PORT/assets/asset_$i.js\"" >> "$URL_FILE"
+	echo "output = \"/dev/null\"" >> "$URL_FILE"
+	i=$((i + 1))
+done
+
+$SERVER_BINARY --port $PORT --root "$BENCH_ROOT/" &
+SERVER_PID=$!
+sleep 0.5
+
+now_in_ms()
+{
+	echo $(( $(date +%s%N) / 1000000 ))
+}
+
+# $1: label, remaining arguments: curl protocol options
+run_benchmark()
+{
+	LABEL=$1
+	shift
+
+	TOTAL_MS=0
+	ROUND=0
+	while [ $ROUND -lt $ROUNDS ]; do
+		START_MS=$(now_in_ms)
+		if ! curl -s -f --no-progress-meter "$@" --parallel -K "$URL_FILE"; then
+			echo "$LABEL: request failed"
+			exit 1
+		fi
+		END_MS=$(now_in_ms)
+		TOTAL_MS=$((TOTAL_MS + END_MS - START_MS))
+		ROUND=$((ROUND + 1))
+	done
+
+	AVERAGE_MS=$((TOTAL_MS / ROUNDS))
+	echo "$LABEL: $ASSET_COUNT assets in ${AVERAGE_MS}ms (average of $ROUNDS rounds)"
+}
+
+# browsers open up to six HTTP/1.1 connections per origin
+run_benchmark "HTTP/1.1 (6 connections)" --http1.1 --parallel-max 6
+# h2c via Upgrade: curl 7.88 fails to reuse prior knowledge connections for a second stream
+run_benchmark "HTTP/2   (1 connection) " --http2 --parallel-max 100
@@ -0,0 +1,41 @@
+#!/bin/sh
+# Usage: ./build.sh [release|debug] (defaults to release)
+
+PROJECT_NAME=k15_server_manager
+C_FILE_NAME=k15_server_manager.cpp
+BUILD_CONFIGURATION=${1:-release}
+
+CXX=${CXX:-g++}
+CC=${CC:-gcc}
+
+COMPILER_OPTIONS="-std=c++17 -Wall -g"
+
+if [ "$BUILD_CONFIGURATION" = "debug" ]; then
+	COMPILER_OPTIONS="$COMPILER_OPTIONS -O0"
+elif [ "$BUILD_CONFIGURATION" = "release" ]; then
+	# keep frame pointers so perf can unwind the call stacks of the optimized binary
+	COMPILER_OPTIONS="$COMPILER_OPTIONS -O2 -flto -DNDEBUG -fno-omit-frame-pointer"
+else
+	echo "Unknown build configuration '$BUILD_CONFIGURATION', use 'release' or 'debug'."
+	exit 1
+fi
+
+# the unity build pulls the linux platform layer out of the k15_std submodule
+for K15_STD_SOURCE in k15_platform_linux.cpp k15_profiling_linux.cpp k15_path_linux.cpp; do
+	if [ ! -f "k15_std/src/$K15_STD_SOURCE" ]; then
+		echo "k15_std/src/$K15_STD_SOURCE is missing, run 'git submodule update --init' with a k15_std revision that has linux support."
+		exit 1
+	fi
+done
+
+# game servers include k15_status_board.h from plain C, make sure it still compiles as strict C
+for C_STANDARD in c99 c11; do
+	if ! echo '#include "k15_status_board.h"' | $CC -std=$C_STANDARD -Wall -Wextra -pedantic -Werror -fsyntax-only -I. -x c -; then
+		echo "k15_status_board.h doesn't compile with -std=$C_STANDARD."
+		exit 1
+	fi
+done
+
+echo "Starting $BUILD_CONFIGURATION build process..."
+# shm_open lives in librt on glibc < 2.34
+$CXX $COMPILER_OPTIONS $C_FILE_NAME -o $PROJECT_NAME -lrt
@@ -0,0 +1,692 @@
+#ifndef K15_DIRECTORY_LISTING_INCLUDE
+#define K15_DIRECTORY_LISTING_INCLUDE
+
+#include "k15_std/include/k15_container.hpp"
+#include "k15_std/include/k15_memory.hpp"
+
+#if defined( _WIN32 )
+#    include <windows.h>
+#else
+#    include <sys/types.h>
+#    include <sys/stat.h>
+#    include <sys/syscall.h>
+#    include <dirent.h>
+#    include <fcntl.h>
+#    include <time.h>
+#    include <unistd.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+
+namespace k15
+{
+    enum : uint32
+    {
+        DirectoryReadBufferSize          = 64u * 1024u,
+        DirectoryPathLength              = 4096u, //FK: PATH_MAX on linux
+        DirectoryListingLineLength       = 4096u,
+        DirectoryListingCacheSlotCount   = 16u,
+        DirectoryListingMaxCacheSize     = 8u * 1024u * 1024u,
+        DirectoryListingInitialCacheSize = 4u * 1024u
+    };
+
+    enum : uint64
+    {
+        DirectoryListingMtimeGranularity = 1000000000u //FK: in nanoseconds
+    };
+
+    struct directory_entry
+    {
+        const char* pName;
+        bool        isDirectory;
+    };
+
+    struct directory_reader
+    {
+#if defined( _WIN32 )
+        HANDLE           findHandle;
+        WIN32_FIND_DATAA findData;
+        bool             hasPendingEntry;
+#else
+        //FK: getdents64 fills the buffer with as many entries as fit, so huge directories only need a handful of syscalls
+        int    directoryDescriptor;
+        size_t bufferOffset;
+        size_t bufferSize;
+        alignas( 8 ) char buffer[ DirectoryReadBufferSize ];
+#endif
+    };
+
+    struct directory_listing_cache_entry
+    {
+        char                  directoryPath[ DirectoryPathLength ];
+        uint64                modificationTime;
+        uint64                lastUseTick;
+        dynamic_array< char > renderedListing;
+        uint32                pinCount; //FK: streams currently reading or filling renderedListing
+        bool                  isValid;
+    };
+
+    //FK: Rendered listings are keyed by directory path and only reused while the directory's mtime is unchanged.
+    //    Only the part after the header is cached, it contains nothing but names and hrefs relative to the directory,
+    //    so mtime (which changes on create/delete/rename) is the invalidation key.
+    //    Kernel timestamps come from a coarse clock though, so directories modified within the last
+    //    DirectoryListingMtimeGranularity aren't cached - a second change in the same tick wouldn't move the mtime.
+    //    h2 streams interleave, so every stream pins the entry it reads or fills. Pinned entries are never cleared or
+    //    evicted and only an unpinned entry can be filled, which means there's at most one stream filling an entry.
+    struct directory_listing_cache
+    {
+        directory_listing_cache_entry entries[ DirectoryListingCacheSlotCount ];
+        uint64                        useTick;
+    };
+
+    enum class directory_read_result
+    {
+        entry,
+        end_of_directory,
+        error
+    };
+
+    enum class directory_listing_stage
+    {
+        header,
+        entries,
+        footer,
+        finished,
+        failed
+    };
+
+    struct directory_listing_stream
+    {
+        directory_reader               reader;
+        directory_listing_cache_entry* pCacheEntry;
+        size_t                         cacheReadOffset;
+        bool                           isCacheHit;
+        directory_listing_stage        stage;
+        char                           requestPath[ DirectoryPathLength ];
+        char                           line[ DirectoryListingLineLength ];
+        size_t                         lineSize;
+        size_t                         lineOffset;
+    };
+
+#if !defined( _WIN32 )
+    struct linux_dirent64
+    {
+        uint64         d_ino;
+        int64          d_off;
+        unsigned short d_reclen;
+        unsigned char  d_type;
+        char           d_name[ 1 ];
+    };
+#endif
+
+    bool isDotDirectoryEntry( const char* pName )
+    {
+        return ( pName[ 0 ] == '.' && pName[ 1 ] == 0 ) || ( pName[ 0 ] == '.' && pName[ 1 ] == '.' && pName[ 2 ] == 0 );
+    }
+
+    bool getDirectoryModificationTime( const char* pDirectoryPath, uint64* pModificationTime )
+    {
+#if defined( _WIN32 )
+        WIN32_FILE_ATTRIBUTE_DATA attributeData;
+        if ( !GetFileAttributesExA( pDirectoryPath, GetFileExInfoStandard, &attributeData ) )
+        {
+            return false;
+        }
+
+        //FK: FILETIME counts 100ns ticks
+        *pModificationTime = ( ( ( uint64 )attributeData.ftLastWriteTime.dwHighDateTime << 32u ) | attributeData.ftLastWriteTime.dwLowDateTime ) * 100u;
+        return true;
+#else
+        struct stat directoryStat;
+        if ( stat( pDirectoryPath, &directoryStat ) != 0 || !S_ISDIR( directoryStat.st_mode ) )
+        {
+            return false;
+        }
+
+        *pModificationTime = ( uint64 )directoryStat.st_mtim.tv_sec * 1000000000u + ( uint64 )directoryStat.st_mtim.tv_nsec;
+        return true;
+#endif
+    }
+
+    //FK: Same clock and unit (nanoseconds) as getDirectoryModificationTime
+    bool isDirectoryModificationRecent( uint64 modificationTime )
+    {
+#if defined( _WIN32 )
+        FILETIME currentFileTime;
+        GetSystemTimeAsFileTime( &currentFileTime );
+        const uint64 currentTime = ( ( ( uint64 )currentFileTime.dwHighDateTime << 32u ) | currentFileTime.dwLowDateTime ) * 100u;
+#else
+        struct timespec currentTimeSpec;
+        clock_gettime( CLOCK_REALTIME, &currentTimeSpec );
+        const uint64 currentTime = ( uint64 )currentTimeSpec.tv_sec * 1000000000u + ( uint64 )currentTimeSpec.tv_nsec;
+#endif
+        //FK: A clock that went backwards counts as recent as well
+        return modificationTime + DirectoryListingMtimeGranularity > currentTime;
+    }
+
+    bool openDirectoryReader( directory_reader* pReader, const char* pDirectoryPath )
+    {
+#if defined( _WIN32 )
+        char searchPattern[ DirectoryPathLength + 2 ];
+        if ( snprintf( searchPattern, sizeof( searchPattern ), "%s\\*", pDirectoryPath ) >= ( int )sizeof( searchPattern ) )
+        {
+            return false;
+        }
+
+        pReader->findHandle      = FindFirstFileA( searchPattern, &pReader->findData );
+        pReader->hasPendingEntry = pReader->findHandle != INVALID_HANDLE_VALUE;
+        return pReader->findHandle != INVALID_HANDLE_VALUE;
+#else
+        pReader->directoryDescriptor = open( pDirectoryPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+        pReader->bufferOffset        = 0u;
+        pReader->bufferSize          = 0u;
+        return pReader->directoryDescriptor != -1;
+#endif
+    }
+
+    void closeDirectoryReader( directory_reader* pReader )
+    {
+#if defined( _WIN32 )
+        if ( pReader->findHandle != INVALID_HANDLE_VALUE )
+        {
+            FindClose( pReader->findHandle );
+            pReader->findHandle = INVALID_HANDLE_VALUE;
+        }
+#else
+        if ( pReader->directoryDescriptor != -1 )
+        {
+            close( pReader->directoryDescriptor );
+            pReader->directoryDescriptor = -1;
+        }
+#endif
+    }
+
+    //FK: pEntry->pName stays valid until the next call
+    directory_read_result readNextDirectoryEntry( directory_reader* pReader, directory_entry* pEntry )
+    {
+#if defined( _WIN32 )
+        while ( true )
+        {
+            if ( !pReader->hasPendingEntry && !FindNextFileA( pReader->findHandle, &pReader->findData ) )
+            {
+                return GetLastError() == ERROR_NO_MORE_FILES ? directory_read_result::end_of_directory : directory_read_result::error;
+            }
+
+            pReader->hasPendingEntry = false;
+            if ( isDotDirectoryEntry( pReader->findData.cFileName ) )
+            {
+                continue;
+            }
+
+            pEntry->pName       = pReader->findData.cFileName;
+            pEntry->isDirectory = ( pReader->findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ) != 0;
+            return directory_read_result::entry;
+        }
+#else
+        while ( true )
+        {
+            if ( pReader->bufferOffset >= pReader->bufferSize )
+            {
+                const long bytesRead = syscall( SYS_getdents64, pReader->directoryDescriptor, pReader->buffer, sizeof( pReader->buffer ) );
+                if ( bytesRead < 0 )
+                {
+                    return directory_read_result::error;
+                }
+
+                if ( bytesRead == 0 )
+                {
+                    return directory_read_result::end_of_directory;
+                }
+
+                pReader->bufferOffset = 0u;
+                pReader->bufferSize   = ( size_t )bytesRead;
+            }
+
+            const linux_dirent64* pDirent = ( const linux_dirent64* )( pReader->buffer + pReader->bufferOffset );
+            pReader->bufferOffset += pDirent->d_reclen;
+
+            if ( isDotDirectoryEntry( pDirent->d_name ) )
+            {
+                continue;
+            }
+
+            bool isDirectory = pDirent->d_type == DT_DIR;
+            if ( pDirent->d_type == DT_UNKNOWN || pDirent->d_type == DT_LNK )
+            {
+                //FK: Some filesystems don't fill d_type and symlinks should be listed as what they point to
+                struct stat entryStat;
+                isDirectory = fstatat( pReader->directoryDescriptor, pDirent->d_name, &entryStat, 0 ) == 0 && S_ISDIR( entryStat.st_mode );
+            }
+
+            pEntry->pName       = pDirent->d_name;
+            pEntry->isDirectory = isDirectory;
+            return directory_read_result::entry;
+        }
+#endif
+    }
+
+    bool createDirectoryListingCache( directory_listing_cache* pCache, memory_allocator* pAllocator )
+    {
+        pCache->useTick = 0u;
+        for ( size_t entryIndex = 0u; entryIndex < DirectoryListingCacheSlotCount; ++entryIndex )
+        {
+            directory_listing_cache_entry* pEntry = pCache->entries + entryIndex;
+            pEntry->directoryPath[ 0 ]            = 0;
+            pEntry->modificationTime              = 0u;
+            pEntry->lastUseTick                   = 0u;
+            pEntry->pinCount                      = 0u;
+            pEntry->isValid                       = false;
+
+            if ( !pEntry->renderedListing.create( pAllocator, DirectoryListingInitialCacheSize ) )
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    directory_listing_cache_entry* findDirectoryListingCacheEntry( directory_listing_cache* pCache, const char* pDirectoryPath )
+    {
+        for ( size_t entryIndex = 0u; entryIndex < DirectoryListingCacheSlotCount; ++entryIndex )
+        {
+            directory_listing_cache_entry* pEntry = pCache->entries + entryIndex;
+            if ( strcmp( pEntry->directoryPath, pDirectoryPath ) == 0 )
+            {
+                return pEntry;
+            }
+        }
+
+        return nullptr;
+    }
+
+    //FK: Returns an entry pinned for filling or nullptr if the listing can't be cached right now
+    //    (entry is in use by another stream or every entry is pinned)
+    directory_listing_cache_entry* acquireDirectoryListingCacheEntry( directory_listing_cache* pCache, const char* pDirectoryPath )
+    {
+        directory_listing_cache_entry* pTargetEntry = findDirectoryListingCacheEntry( pCache, pDirectoryPath );
+        if ( pTargetEntry != nullptr && pTargetEntry->pinCount > 0u )
+        {
+            return nullptr;
+        }
+
+        if ( pTargetEntry == nullptr )
+        {
+            for ( size_t entryIndex = 0u; entryIndex < DirectoryListingCacheSlotCount; ++entryIndex )
+            {
+                directory_listing_cache_entry* pEntry = pCache->entries + entryIndex;
+                if ( pEntry->pinCount == 0u && ( pTargetEntry == nullptr || pEntry->lastUseTick < pTargetEntry->lastUseTick ) )
+                {
+                    pTargetEntry = pEntry;
+                }
+            }
+
+            if ( pTargetEntry == nullptr )
+            {
+                return nullptr;
+            }
+
+            const size_t pathLength = strlen( pDirectoryPath );
+            if ( pathLength >= DirectoryPathLength )
+            {
+                return nullptr;
+            }
+
+            copyMemoryNonOverlapping( pTargetEntry->directoryPath, DirectoryPathLength, pDirectoryPath, pathLength + 1u );
+        }
+
+        pTargetEntry->isValid = false;
+        pTargetEntry->renderedListing.clear();
+        pTargetEntry->lastUseTick = ++pCache->useTick;
+        pTargetEntry->pinCount    = 1u;
+        return pTargetEntry;
+    }
+
+    void releaseDirectoryListingCacheEntry( directory_listing_cache_entry* pEntry, bool publish )
+    {
+        K15_ASSERT( pEntry->pinCount > 0u );
+        --pEntry->pinCount;
+
+        if ( publish )
+        {
+            pEntry->isValid = true;
+        }
+        else if ( !pEntry->isValid )
+        {
+            //FK: Abandoned fill, don't keep the partial listing around
+            pEntry->directoryPath[ 0 ] = 0;
+            pEntry->renderedListing.clear();
+        }
+    }
+
+    bool appendToListingLine( directory_listing_stream* pStream, const char* pText, size_t textLength )
+    {
+        if ( pStream->lineSize + textLength > DirectoryListingLineLength )
+        {
+            return false;
+        }
+
+        copyMemoryNonOverlapping( pStream->line + pStream->lineSize, DirectoryListingLineLength - pStream->lineSize, pText, textLength );
+        pStream->lineSize += textLength;
+        return true;
+    }
+
+    bool appendToListingLine( directory_listing_stream* pStream, const char* pText )
+    {
+        return appendToListingLine( pStream, pText, strlen( pText ) );
+    }
+
+    bool appendHtmlEscapedToListingLine( directory_listing_stream* pStream, const char* pText )
+    {
+        for ( ; *pText != 0; ++pText )
+        {
+            bool appended = false;
+            switch ( *pText )
+            {
+            case '&': appended = appendToListingLine( pStream, "&amp;" ); break;
+            case '<': appended = appendToListingLine( pStream, "&lt;" ); break;
+            case '>': appended = appendToListingLine( pStream, "&gt;" ); break;
+            case '"': appended = appendToListingLine( pStream, "&quot;" ); break;
+            default: appended = appendToListingLine( pStream, pText, 1u ); break;
+            }
+
+            if ( !appended )
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool appendUrlEncodedToListingLine( directory_listing_stream* pStream, const char* pText, bool keepSlashes )
+    {
+        const char hexDigits[] = "0123456789ABCDEF";
+        for ( ; *pText != 0; ++pText )
+        {
+            const unsigned char character = ( unsigned char )*pText;
+            const bool          isUnreserved =
+                ( character >= 'a' && character <= 'z' ) || ( character >= 'A' && character <= 'Z' ) || ( character >= '0' && character <= '9' ) ||
+                character == '-' || character == '_' || character == '.' || character == '~' || ( keepSlashes && character == '/' );
+
+            if ( isUnreserved )
+            {
+                if ( !appendToListingLine( pStream, pText, 1u ) )
+                {
+                    return false;
+                }
+
+                continue;
+            }
+
+            const char encodedCharacter[] = { '%', hexDigits[ character >> 4u ], hexDigits[ character & 0xFu ] };
+            if ( !appendToListingLine( pStream, encodedCharacter, sizeof( encodedCharacter ) ) )
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool appendDirectoryHrefToListingLine( directory_listing_stream* pStream )
+    {
+        if ( !appendUrlEncodedToListingLine( pStream, pStream->requestPath, true ) )
+        {
+            return false;
+        }
+
+        const size_t requestPathLength = strlen( pStream->requestPath );
+        if ( requestPathLength == 0u || pStream->requestPath[ requestPathLength - 1u ] != '/' )
+        {
+            return appendToListingLine( pStream, "/" );
+        }
+
+        return true;
+    }
+
+    //FK: The only part of the listing that depends on the request path, it's never cached. Several request paths can
+    //    end up in the same directory (eg. '/logs' and '/logs/'), so the entries use hrefs relative to <base>
+    bool renderDirectoryListingHeader( directory_listing_stream* pStream )
+    {
+        bool rendered = appendToListingLine( pStream, "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><base href=\"" ) &&
+                        appendDirectoryHrefToListingLine( pStream ) &&
+                        appendToListingLine( pStream, "\"><title>Index of " ) &&
+                        appendHtmlEscapedToListingLine( pStream, pStream->requestPath ) &&
+                        appendToListingLine( pStream, "</title></head><body><h1>Index of " ) &&
+                        appendHtmlEscapedToListingLine( pStream, pStream->requestPath ) &&
+                        appendToListingLine( pStream, "</h1><pre>\n" );
+
+        const bool isRootDirectory = pStream->requestPath[ 0 ] == 0 || strcmp( pStream->requestPath, "/" ) == 0;
+        if ( rendered && !isRootDirectory )
+        {
+            rendered = appendToListingLine( pStream, "<a href=\"../\">../</a>\n" );
+        }
+
+        return rendered;
+    }
+
+    bool renderDirectoryListingEntry( directory_listing_stream* pStream, const directory_entry& entry )
+    {
+        const char* pDirectorySuffix = entry.isDirectory ? "/" : "";
+        return appendToListingLine( pStream, "<a href=\"" ) &&
+               appendUrlEncodedToListingLine( pStream, entry.pName, false ) &&
+               appendToListingLine( pStream, pDirectorySuffix ) &&
+               appendToListingLine( pStream, "\">" ) &&
+               appendHtmlEscapedToListingLine( pStream, entry.pName ) &&
+               appendToListingLine( pStream, pDirectorySuffix ) &&
+               appendToListingLine( pStream, "</a>\n" );
+    }
+
+    //FK: Renders the next line of the listing into pStream->line, returns false when there's nothing left to render
+    bool renderNextDirectoryListingLine( directory_listing_stream* pStream )
+    {
+        pStream->lineSize   = 0u;
+        pStream->lineOffset = 0u;
+
+        bool rendered    = false;
+        bool isCacheable = true;
+        switch ( pStream->stage )
+        {
+        case directory_listing_stage::header:
+            {
+                //FK: On a cache hit everything after the header comes straight out of the cache
+                rendered       = renderDirectoryListingHeader( pStream );
+                isCacheable    = false;
+                pStream->stage = pStream->isCacheHit ? directory_listing_stage::finished : directory_listing_stage::entries;
+                break;
+            }
+
+        case directory_listing_stage::entries:
+            {
+                directory_entry             entry;
+                const directory_read_result readResult = readNextDirectoryEntry( &pStream->reader, &entry );
+                if ( readResult == directory_read_result::entry )
+                {
+                    rendered = renderDirectoryListingEntry( pStream, entry );
+                    break;
+                }
+
+                if ( readResult == directory_read_result::error )
+                {
+                    //FK: A truncated listing must neither end up in the cache nor look complete to the client
+                    if ( pStream->pCacheEntry != nullptr )
+                    {
+                        releaseDirectoryListingCacheEntry( pStream->pCacheEntry, false );
+                        pStream->pCacheEntry = nullptr;
+                    }
+
+                    pStream->stage = directory_listing_stage::failed;
+                    return false;
+                }
+
+                pStream->stage = directory_listing_stage::footer;
+                //FK: fall through to render the footer right away
+            }
+
+        case directory_listing_stage::footer:
+            {
+                rendered       = appendToListingLine( pStream, "</pre></body></html>\n" );
+                pStream->stage = directory_listing_stage::finished;
+                break;
+            }
+
+        case directory_listing_stage::finished:
+            {
+                if ( pStream->pCacheEntry != nullptr )
+                {
+                    releaseDirectoryListingCacheEntry( pStream->pCacheEntry, true );
+                    pStream->pCacheEntry = nullptr;
+                }
+
+                return false;
+            }
+
+        case directory_listing_stage::failed:
+            {
+                return false;
+            }
+        }
+
+        if ( !rendered )
+        {
+            //FK: Can only happen for names that don't fit into a line, skip them rather than sending broken html
+            pStream->lineSize = 0u;
+            return true;
+        }
+
+        if ( pStream->pCacheEntry != nullptr && isCacheable )
+        {
+            dynamic_array< char >* pRenderedListing = &pStream->pCacheEntry->renderedListing;
+            char*                  pCacheTarget     = nullptr;
+            if ( pRenderedListing->getSize() + pStream->lineSize <= DirectoryListingMaxCacheSize )
+            {
+                pCacheTarget = pRenderedListing->pushBackRange( pStream->lineSize );
+            }
+
+            if ( pCacheTarget == nullptr )
+            {
+                //FK: Too big (or out of memory), this listing simply won't be cached
+                releaseDirectoryListingCacheEntry( pStream->pCacheEntry, false );
+                pStream->pCacheEntry = nullptr;
+            }
+            else
+            {
+                copyMemoryNonOverlapping( pCacheTarget, pStream->lineSize, pStream->line, pStream->lineSize );
+            }
+        }
+
+        return true;
+    }
+
+    result< void > openDirectoryListingStream( directory_listing_stream* pStream, directory_listing_cache* pCache, const char* pDirectoryPath, const char* pRequestPath )
+    {
+        uint64 modificationTime = 0u;
+        if ( !getDirectoryModificationTime( pDirectoryPath, &modificationTime ) )
+        {
+            return error_id::not_found;
+        }
+
+        const size_t requestPathLength = strlen( pRequestPath );
+        if ( requestPathLength >= DirectoryPathLength )
+        {
+            return error_id::not_supported;
+        }
+
+        copyMemoryNonOverlapping( pStream->requestPath, DirectoryPathLength, pRequestPath, requestPathLength + 1u );
+        pStream->cacheReadOffset = 0u;
+        pStream->lineSize        = 0u;
+        pStream->lineOffset      = 0u;
+        pStream->stage           = directory_listing_stage::header;
+
+        directory_listing_cache_entry* pCachedEntry = findDirectoryListingCacheEntry( pCache, pDirectoryPath );
+        if ( pCachedEntry != nullptr && pCachedEntry->isValid && pCachedEntry->modificationTime == modificationTime )
+        {
+            pCachedEntry->lastUseTick = ++pCache->useTick;
+            ++pCachedEntry->pinCount;
+            pStream->pCacheEntry = pCachedEntry;
+            pStream->isCacheHit  = true;
+            return error_id::success;
+        }
+
+        if ( !openDirectoryReader( &pStream->reader, pDirectoryPath ) )
+        {
+            return error_id::not_found;
+        }
+
+        pStream->isCacheHit  = false;
+        pStream->pCacheEntry = isDirectoryModificationRecent( modificationTime ) ? nullptr : acquireDirectoryListingCacheEntry( pCache, pDirectoryPath );
+        if ( pStream->pCacheEntry != nullptr )
+        {
+            pStream->pCacheEntry->modificationTime = modificationTime;
+        }
+
+        return error_id::success;
+    }
+
+    void closeDirectoryListingStream( directory_listing_stream* pStream )
+    {
+        if ( pStream->pCacheEntry != nullptr )
+        {
+            releaseDirectoryListingCacheEntry( pStream->pCacheEntry, false );
+            pStream->pCacheEntry = nullptr;
+        }
+
+        if ( !pStream->isCacheHit )
+        {
+            closeDirectoryReader( &pStream->reader );
+        }
+    }
+
+    size_t copyCachedDirectoryListing( directory_listing_stream* pStream, char* pBuffer, size_t bufferSizeInBytes )
+    {
+        const dynamic_array< char >& renderedListing = pStream->pCacheEntry->renderedListing;
+        const size_t                 remainingBytes  = renderedListing.getSize() - pStream->cacheReadOffset;
+        const size_t                 chunkSize       = remainingBytes < bufferSizeInBytes ? remainingBytes : bufferSizeInBytes;
+
+        copyMemoryNonOverlapping( pBuffer, bufferSizeInBytes, renderedListing.getStart() + pStream->cacheReadOffset, chunkSize );
+        pStream->cacheReadOffset += chunkSize;
+        return chunkSize;
+    }
+
+    result< size_t > produceDirectoryListingChunk( void* pUserData, char* pBuffer, size_t bufferSizeInBytes )
+    {
+        directory_listing_stream* pStream = ( directory_listing_stream* )pUserData;
+
+        size_t bytesWritten = 0u;
+        while ( bytesWritten < bufferSizeInBytes )
+        {
+            if ( pStream->lineOffset == pStream->lineSize )
+            {
+                if ( pStream->isCacheHit && pStream->stage == directory_listing_stage::finished )
+                {
+                    bytesWritten += copyCachedDirectoryListing( pStream, pBuffer + bytesWritten, bufferSizeInBytes - bytesWritten );
+                    break;
+                }
+
+                if ( !renderNextDirectoryListingLine( pStream ) )
+                {
+                    if ( pStream->stage == directory_listing_stage::failed )
+                    {
+                        //FK: No terminating chunk / END_STREAM, the client sees the response as incomplete
+                        return error_id::generic;
+                    }
+
+                    break;
+                }
+            }
+
+            const size_t remainingLineBytes = pStream->lineSize - pStream->lineOffset;
+            const size_t remainingBytes     = bufferSizeInBytes - bytesWritten;
+            const size_t copySize           = remainingLineBytes < remainingBytes ? remainingLineBytes : remainingBytes;
+
+            copyMemoryNonOverlapping( pBuffer + bytesWritten, remainingBytes, pStream->line + pStream->lineOffset, copySize );
+            pStream->lineOffset += copySize;
+            bytesWritten += copySize;
+        }
+
+        return bytesWritten;
+    }
+} // namespace k15
+
+#endif //K15_DIRECTORY_LISTING_INCLUDE
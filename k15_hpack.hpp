@@ -0,0 +1,825 @@
+#ifndef K15_HPACK_INCLUDE
+#define K15_HPACK_INCLUDE
+
+#include "k15_std/include/k15_base.hpp"
+#include "k15_std/include/k15_memory.hpp"
+
+#include <string.h>
+
+namespace k15
+{
+    enum : uint32
+    {
+        HpackHuffmanSymbolCount        = 257,
+        HpackHuffmanEndOfString        = 256,
+        HpackHuffmanMaxCodeLength      = 30,
+        HpackStaticTableSize           = 61,
+        HpackEntryOverhead             = 32,
+        HpackDefaultDynamicTableSize   = 4096,
+        HpackMaxDynamicTableEntryCount = HpackDefaultDynamicTableSize / HpackEntryOverhead
+    };
+
+    enum class hpack_indexing
+    {
+        incremental,
+        without,
+        never
+    };
+
+    struct hpack_static_entry
+    {
+        const char* pName;
+        const char* pValue;
+    };
+
+    struct hpack_header_field
+    {
+        const char* pName;
+        size_t      nameLength;
+        const char* pValue;
+        size_t      valueLength;
+    };
+
+    struct hpack_dynamic_table_entry
+    {
+        uint16 storageOffset;
+        uint16 nameLength;
+        uint16 valueLength;
+    };
+
+    //FK: Entries are appended behind each other in pStorage and evicted from the front, so the live bytes are always
+    //    one contiguous range [storageStart, storageEnd). When the end is reached the range gets moved back to offset 0.
+    struct hpack_dynamic_table
+    {
+        char*                      pStorage;
+        size_t                     storageCapacity;
+        size_t                     storageStart;
+        size_t                     storageEnd;
+        hpack_dynamic_table_entry* pEntries; //FK: ring buffer, oldest entry at firstEntryIndex
+        size_t                     firstEntryIndex;
+        size_t                     entryCount;
+        size_t                     size; //FK: size as defined by RFC 7541 4.1 (includes 32 byte overhead per entry)
+        size_t                     maxSize;
+    };
+
+    struct hpack_decoder
+    {
+        hpack_dynamic_table table;
+        size_t              maxSizeLimit; //FK: SETTINGS_HEADER_TABLE_SIZE we announced to the peer
+    };
+
+    struct hpack_encoder
+    {
+        hpack_dynamic_table table;
+        size_t              pendingMaxSize;
+        bool                hasPendingMaxSizeUpdate;
+    };
+
+    struct hpack_buffer
+    {
+        uint8* pData;
+        size_t size;
+        size_t capacity;
+    };
+
+    typedef void ( *hpack_header_callback )( void* pUserData, const hpack_header_field& field );
+
+    const uint32 hpackHuffmanCodes[ HpackHuffmanSymbolCount ] = {
+        0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+        0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+        0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+        0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+        0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+        0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+        0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+        0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+        0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+        0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+        0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+        0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+        0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+        0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+        0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+        0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+        0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+        0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+        0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+        0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+        0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+        0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+        0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+        0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+        0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+        0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+        0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+        0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+        0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+        0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+        0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+        0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+        0x3fffffff
+    };
+
+    const uint8 hpackHuffmanCodeLengths[ HpackHuffmanSymbolCount ] = {
+        13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+        28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+        6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+        5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+        13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+        15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+        6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+        20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+        24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+        22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+        21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+        26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+        19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+        20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+        26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+        30
+    };
+
+    //FK: The code is canonical, so per code length the codes are consecutive and the symbols sorted by code.
+    //    That allows decoding with these three small tables instead of a tree
+    const uint32 hpackHuffmanFirstCodeByLength[ HpackHuffmanMaxCodeLength + 1 ] = {
+        0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x14, 0x5c,
+        0xf8, 0x0, 0x3f8, 0x7fa, 0xffa, 0x1ff8, 0x3ffc, 0x7ffc,
+        0x0, 0x0, 0x0, 0x7fff0, 0xfffe6, 0x1fffdc, 0x3fffd2, 0x7fffd8,
+        0xffffea, 0x1ffffec, 0x3ffffe0, 0x7ffffde, 0xfffffe2, 0x0, 0x3ffffffc
+    };
+
+    const uint16 hpackHuffmanCodeCountByLength[ HpackHuffmanMaxCodeLength + 1 ] = {
+        0, 0, 0, 0, 0, 10, 26, 32, 6, 0, 5, 3, 2, 6, 2, 3,
+        0, 0, 0, 3, 8, 13, 26, 29, 12, 4, 15, 19, 29, 0, 4
+    };
+
+    const uint16 hpackHuffmanFirstSymbolIndexByLength[ HpackHuffmanMaxCodeLength + 1 ] = {
+        0, 0, 0, 0, 0, 0, 10, 36, 68, 0, 74, 79, 82, 84, 90, 92,
+        0, 0, 0, 95, 98, 106, 119, 145, 174, 186, 190, 205, 224, 0, 253
+    };
+
+    const uint16 hpackHuffmanSymbolsByCode[ HpackHuffmanSymbolCount ] = {
+        48, 49, 50, 97, 99, 101, 105, 111, 115, 116, 32, 37, 45, 46, 47, 51,
+        52, 53, 54, 55, 56, 57, 61, 65, 95, 98, 100, 102, 103, 104, 108, 109,
+        110, 112, 114, 117, 58, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76,
+        77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 89, 106, 107, 113, 118,
+        119, 120, 121, 122, 38, 42, 44, 59, 88, 90, 33, 34, 40, 41, 63, 39,
+        43, 124, 35, 62, 0, 36, 64, 91, 93, 126, 94, 125, 60, 96, 123, 92,
+        195, 208, 128, 130, 131, 162, 184, 194, 224, 226, 153, 161, 167, 172, 176, 177,
+        179, 209, 216, 217, 227, 229, 230, 129, 132, 133, 134, 136, 146, 154, 156, 160,
+        163, 164, 169, 170, 173, 178, 181, 185, 186, 187, 189, 190, 196, 198, 228, 232,
+        233, 1, 135, 137, 138, 139, 140, 141, 143, 147, 149, 150, 151, 152, 155, 157,
+        158, 165, 166, 168, 174, 175, 180, 182, 183, 188, 191, 197, 231, 239, 9, 142,
+        144, 145, 148, 159, 171, 206, 215, 225, 236, 237, 199, 207, 234, 235, 192, 193,
+        200, 201, 202, 205, 210, 213, 218, 219, 238, 240, 242, 243, 255, 203, 204, 211,
+        212, 214, 221, 222, 223, 241, 244, 245, 246, 247, 248, 250, 251, 252, 253, 254,
+        2, 3, 4, 5, 6, 7, 8, 11, 12, 14, 15, 16, 17, 18, 19, 20,
+        21, 23, 24, 25, 26, 27, 28, 29, 30, 31, 127, 220, 249, 10, 13, 22,
+        256
+    };
+
+    //FK: RFC 7541 Appendix A, index 1 is the first entry
+    const hpack_static_entry hpackStaticTable[ HpackStaticTableSize ] = {
+        { ":authority", "" },
+        { ":method", "GET" },
+        { ":method", "POST" },
+        { ":path", "/" },
+        { ":path", "/index.html" },
+        { ":scheme", "http" },
+        { ":scheme", "https" },
+        { ":status", "200" },
+        { ":status", "204" },
+        { ":status", "206" },
+        { ":status", "304" },
+        { ":status", "400" },
+        { ":status", "404" },
+        { ":status", "500" },
+        { "accept-charset", "" },
+        { "accept-encoding", "gzip, deflate" },
+        { "accept-language", "" },
+        { "accept-ranges", "" },
+        { "accept", "" },
+        { "access-control-allow-origin", "" },
+        { "age", "" },
+        { "allow", "" },
+        { "authorization", "" },
+        { "cache-control", "" },
+        { "content-disposition", "" },
+        { "content-encoding", "" },
+        { "content-language", "" },
+        { "content-length", "" },
+        { "content-location", "" },
+        { "content-range", "" },
+        { "content-type", "" },
+        { "cookie", "" },
+        { "date", "" },
+        { "etag", "" },
+        { "expect", "" },
+        { "expires", "" },
+        { "from", "" },
+        { "host", "" },
+        { "if-match", "" },
+        { "if-modified-since", "" },
+        { "if-none-match", "" },
+        { "if-range", "" },
+        { "if-unmodified-since", "" },
+        { "last-modified", "" },
+        { "link", "" },
+        { "location", "" },
+        { "max-forwards", "" },
+        { "proxy-authenticate", "" },
+        { "proxy-authorization", "" },
+        { "range", "" },
+        { "referer", "" },
+        { "refresh", "" },
+        { "retry-after", "" },
+        { "server", "" },
+        { "set-cookie", "" },
+        { "strict-transport-security", "" },
+        { "transfer-encoding", "" },
+        { "user-agent", "" },
+        { "vary", "" },
+        { "via", "" },
+        { "www-authenticate", "" }
+    };
+
+    void initializeHpackDynamicTable( hpack_dynamic_table* pTable, char* pStorage, hpack_dynamic_table_entry* pEntries, size_t maxSize )
+    {
+        K15_ASSERT( maxSize <= HpackDefaultDynamicTableSize );
+
+        pTable->pStorage        = pStorage;
+        pTable->storageCapacity = maxSize;
+        pTable->storageStart    = 0u;
+        pTable->storageEnd      = 0u;
+        pTable->pEntries        = pEntries;
+        pTable->firstEntryIndex = 0u;
+        pTable->entryCount      = 0u;
+        pTable->size            = 0u;
+        pTable->maxSize         = maxSize;
+    }
+
+    void evictOldestHpackDynamicTableEntry( hpack_dynamic_table* pTable )
+    {
+        K15_ASSERT( pTable->entryCount > 0u );
+
+        const hpack_dynamic_table_entry& entry = pTable->pEntries[ pTable->firstEntryIndex ];
+        const size_t                     bytes = entry.nameLength + entry.valueLength;
+
+        pTable->storageStart += bytes;
+        pTable->size -= bytes + HpackEntryOverhead;
+        pTable->firstEntryIndex = ( pTable->firstEntryIndex + 1u ) % HpackMaxDynamicTableEntryCount;
+        --pTable->entryCount;
+
+        if ( pTable->entryCount == 0u )
+        {
+            pTable->storageStart = 0u;
+            pTable->storageEnd   = 0u;
+        }
+    }
+
+    void setHpackDynamicTableMaxSize( hpack_dynamic_table* pTable, size_t maxSize )
+    {
+        K15_ASSERT( maxSize <= pTable->storageCapacity );
+
+        pTable->maxSize = maxSize;
+        while ( pTable->size > pTable->maxSize )
+        {
+            evictOldestHpackDynamicTableEntry( pTable );
+        }
+    }
+
+    //FK: pName and pValue must not point into the table itself, eviction might overwrite them
+    void addHpackDynamicTableEntry( hpack_dynamic_table* pTable, const char* pName, size_t nameLength, const char* pValue, size_t valueLength )
+    {
+        const size_t entrySize = nameLength + valueLength + HpackEntryOverhead;
+        if ( entrySize > pTable->maxSize )
+        {
+            //FK: RFC 7541 4.4 - an entry bigger than the table empties the table and isn't added
+            while ( pTable->entryCount > 0u )
+            {
+                evictOldestHpackDynamicTableEntry( pTable );
+            }
+
+            return;
+        }
+
+        while ( pTable->size + entrySize > pTable->maxSize )
+        {
+            evictOldestHpackDynamicTableEntry( pTable );
+        }
+
+        const size_t bytes = nameLength + valueLength;
+        if ( pTable->storageEnd + bytes > pTable->storageCapacity )
+        {
+            const size_t liveBytes = pTable->storageEnd - pTable->storageStart;
+            memmove( pTable->pStorage, pTable->pStorage + pTable->storageStart, liveBytes );
+
+            for ( size_t entryIndex = 0u; entryIndex < pTable->entryCount; ++entryIndex )
+            {
+                hpack_dynamic_table_entry* pEntry = pTable->pEntries + ( pTable->firstEntryIndex + entryIndex ) % HpackMaxDynamicTableEntryCount;
+                pEntry->storageOffset             = ( uint16 )( pEntry->storageOffset - pTable->storageStart );
+            }
+
+            pTable->storageStart = 0u;
+            pTable->storageEnd   = liveBytes;
+        }
+
+        const size_t               newEntryIndex = ( pTable->firstEntryIndex + pTable->entryCount ) % HpackMaxDynamicTableEntryCount;
+        hpack_dynamic_table_entry* pNewEntry     = pTable->pEntries + newEntryIndex;
+        pNewEntry->storageOffset                 = ( uint16 )pTable->storageEnd;
+        pNewEntry->nameLength                    = ( uint16 )nameLength;
+        pNewEntry->valueLength                   = ( uint16 )valueLength;
+
+        copyMemoryNonOverlapping( pTable->pStorage + pTable->storageEnd, pTable->storageCapacity - pTable->storageEnd, pName, nameLength );
+        copyMemoryNonOverlapping( pTable->pStorage + pTable->storageEnd + nameLength, pTable->storageCapacity - pTable->storageEnd - nameLength, pValue, valueLength );
+
+        pTable->storageEnd += bytes;
+        pTable->size += entrySize;
+        ++pTable->entryCount;
+    }
+
+    //FK: index is the HPACK index, 1..61 address the static table and everything above the dynamic table (newest first)
+    bool getHpackTableEntry( const hpack_dynamic_table* pTable, size_t index, hpack_header_field* pField )
+    {
+        if ( index == 0u )
+        {
+            return false;
+        }
+
+        if ( index <= HpackStaticTableSize )
+        {
+            const hpack_static_entry& entry = hpackStaticTable[ index - 1u ];
+            pField->pName                   = entry.pName;
+            pField->nameLength              = strlen( entry.pName );
+            pField->pValue                  = entry.pValue;
+            pField->valueLength             = strlen( entry.pValue );
+            return true;
+        }
+
+        const size_t dynamicIndex = index - HpackStaticTableSize - 1u;
+        if ( dynamicIndex >= pTable->entryCount )
+        {
+            return false;
+        }
+
+        const size_t                     newestEntryIndex = pTable->firstEntryIndex + pTable->entryCount - 1u;
+        const hpack_dynamic_table_entry& entry            = pTable->pEntries[ ( newestEntryIndex - dynamicIndex ) % HpackMaxDynamicTableEntryCount ];
+        pField->pName                                     = pTable->pStorage + entry.storageOffset;
+        pField->nameLength                                = entry.nameLength;
+        pField->pValue                                    = pTable->pStorage + entry.storageOffset + entry.nameLength;
+        pField->valueLength                               = entry.valueLength;
+        return true;
+    }
+
+    bool compareHpackString( const char* pA, size_t lengthA, const char* pB, size_t lengthB )
+    {
+        return lengthA == lengthB && memcmp( pA, pB, lengthA ) == 0;
+    }
+
+    //FK: Returns the HPACK index of the best match (0 if none), *pIsFullMatch tells whether the value matched as well
+    size_t findHpackTableEntry( const hpack_dynamic_table* pTable, const char* pName, size_t nameLength, const char* pValue, size_t valueLength, bool* pIsFullMatch )
+    {
+        size_t nameMatchIndex = 0u;
+        *pIsFullMatch         = false;
+
+        for ( size_t staticIndex = 0u; staticIndex < HpackStaticTableSize; ++staticIndex )
+        {
+            const hpack_static_entry& entry = hpackStaticTable[ staticIndex ];
+            if ( !compareHpackString( entry.pName, strlen( entry.pName ), pName, nameLength ) )
+            {
+                continue;
+            }
+
+            if ( compareHpackString( entry.pValue, strlen( entry.pValue ), pValue, valueLength ) )
+            {
+                *pIsFullMatch = true;
+                return staticIndex + 1u;
+            }
+
+            if ( nameMatchIndex == 0u )
+            {
+                nameMatchIndex = staticIndex + 1u;
+            }
+        }
+
+        for ( size_t dynamicIndex = 0u; dynamicIndex < pTable->entryCount; ++dynamicIndex )
+        {
+            hpack_header_field field;
+            getHpackTableEntry( pTable, HpackStaticTableSize + 1u + dynamicIndex, &field );
+
+            if ( !compareHpackString( field.pName, field.nameLength, pName, nameLength ) )
+            {
+                continue;
+            }
+
+            if ( compareHpackString( field.pValue, field.valueLength, pValue, valueLength ) )
+            {
+                *pIsFullMatch = true;
+                return HpackStaticTableSize + 1u + dynamicIndex;
+            }
+
+            if ( nameMatchIndex == 0u )
+            {
+                nameMatchIndex = HpackStaticTableSize + 1u + dynamicIndex;
+            }
+        }
+
+        return nameMatchIndex;
+    }
+
+    bool writeToHpackBuffer( hpack_buffer* pBuffer, const void* pData, size_t dataSizeInBytes )
+    {
+        if ( pBuffer->size + dataSizeInBytes > pBuffer->capacity )
+        {
+            return false;
+        }
+
+        copyMemoryNonOverlapping( pBuffer->pData + pBuffer->size, pBuffer->capacity - pBuffer->size, pData, dataSizeInBytes );
+        pBuffer->size += dataSizeInBytes;
+        return true;
+    }
+
+    bool writeToHpackBuffer( hpack_buffer* pBuffer, uint8 byte )
+    {
+        return writeToHpackBuffer( pBuffer, &byte, 1u );
+    }
+
+    result< uint32 > decodeHpackInteger( const uint8** ppCursor, const uint8* pEnd, uint8 prefixBits )
+    {
+        const uint8* pCursor   = *ppCursor;
+        const uint32 prefixMax = ( 1u << prefixBits ) - 1u;
+        if ( pCursor == pEnd )
+        {
+            return error_id::parse_error;
+        }
+
+        uint32 value = *pCursor++ & prefixMax;
+        if ( value == prefixMax )
+        {
+            uint32 shift = 0u;
+            while ( true )
+            {
+                //FK: Nothing we decode comes close to 2^28, anything longer is garbage or an attack
+                if ( pCursor == pEnd || shift > 21u )
+                {
+                    return error_id::parse_error;
+                }
+
+                const uint8 byte = *pCursor++;
+                value += ( uint32 )( byte & 0x7Fu ) << shift;
+                shift += 7u;
+
+                if ( ( byte & 0x80u ) == 0u )
+                {
+                    break;
+                }
+            }
+        }
+
+        *ppCursor = pCursor;
+        return value;
+    }
+
+    bool encodeHpackInteger( hpack_buffer* pBuffer, uint8 firstByteFlags, uint8 prefixBits, uint32 value )
+    {
+        const uint32 prefixMax = ( 1u << prefixBits ) - 1u;
+        if ( value < prefixMax )
+        {
+            return writeToHpackBuffer( pBuffer, ( uint8 )( firstByteFlags | value ) );
+        }
+
+        if ( !writeToHpackBuffer( pBuffer, ( uint8 )( firstByteFlags | prefixMax ) ) )
+        {
+            return false;
+        }
+
+        value -= prefixMax;
+        while ( value >= 0x80u )
+        {
+            if ( !writeToHpackBuffer( pBuffer, ( uint8 )( ( value & 0x7Fu ) | 0x80u ) ) )
+            {
+                return false;
+            }
+
+            value >>= 7u;
+        }
+
+        return writeToHpackBuffer( pBuffer, ( uint8 )value );
+    }
+
+    result< void > decodeHpackHuffmanString( hpack_buffer* pTarget, const uint8* pData, size_t dataSizeInBytes )
+    {
+        uint32 code       = 0u;
+        uint32 codeLength = 0u;
+
+        for ( size_t byteIndex = 0u; byteIndex < dataSizeInBytes; ++byteIndex )
+        {
+            const uint8 byte = pData[ byteIndex ];
+            for ( int bitIndex = 7; bitIndex >= 0; --bitIndex )
+            {
+                code = ( code << 1u ) | ( ( byte >> bitIndex ) & 1u );
+                ++codeLength;
+
+                if ( codeLength > HpackHuffmanMaxCodeLength )
+                {
+                    return error_id::parse_error;
+                }
+
+                const uint32 codeIndex = code - hpackHuffmanFirstCodeByLength[ codeLength ];
+                if ( code < hpackHuffmanFirstCodeByLength[ codeLength ] || codeIndex >= hpackHuffmanCodeCountByLength[ codeLength ] )
+                {
+                    continue;
+                }
+
+                const uint16 symbol = hpackHuffmanSymbolsByCode[ hpackHuffmanFirstSymbolIndexByLength[ codeLength ] + codeIndex ];
+                if ( symbol == HpackHuffmanEndOfString || !writeToHpackBuffer( pTarget, ( uint8 )symbol ) )
+                {
+                    return symbol == HpackHuffmanEndOfString ? error_id::parse_error : error_id::out_of_memory;
+                }
+
+                code       = 0u;
+                codeLength = 0u;
+            }
+        }
+
+        //FK: RFC 7541 5.2 - padding has to be shorter than 8 bits and consist of the most significant bits of EOS (all ones)
+        if ( codeLength > 7u || code != ( 1u << codeLength ) - 1u )
+        {
+            return error_id::parse_error;
+        }
+
+        return error_id::success;
+    }
+
+    size_t getHpackHuffmanEncodedLength( const char* pString, size_t stringLength )
+    {
+        size_t bitCount = 0u;
+        for ( size_t charIndex = 0u; charIndex < stringLength; ++charIndex )
+        {
+            bitCount += hpackHuffmanCodeLengths[ ( uint8 )pString[ charIndex ] ];
+        }
+
+        return ( bitCount + 7u ) / 8u;
+    }
+
+    bool encodeHpackHuffmanString( hpack_buffer* pBuffer, const char* pString, size_t stringLength )
+    {
+        uint64 bits     = 0u;
+        uint32 bitCount = 0u;
+
+        for ( size_t charIndex = 0u; charIndex < stringLength; ++charIndex )
+        {
+            const uint8 symbol = ( uint8 )pString[ charIndex ];
+            bits               = ( bits << hpackHuffmanCodeLengths[ symbol ] ) | hpackHuffmanCodes[ symbol ];
+            bitCount += hpackHuffmanCodeLengths[ symbol ];
+
+            while ( bitCount >= 8u )
+            {
+                bitCount -= 8u;
+                if ( !writeToHpackBuffer( pBuffer, ( uint8 )( bits >> bitCount ) ) )
+                {
+                    return false;
+                }
+            }
+        }
+
+        if ( bitCount > 0u )
+        {
+            //FK: Pad with the most significant bits of EOS
+            const uint8 paddingBits = ( uint8 )( ( 1u << ( 8u - bitCount ) ) - 1u );
+            return writeToHpackBuffer( pBuffer, ( uint8 )( ( bits << ( 8u - bitCount ) ) | paddingBits ) );
+        }
+
+        return true;
+    }
+
+    //FK: Decoded strings always end up in pScratch, even raw ones, so the header list stays valid while the dynamic table changes
+    result< void > decodeHpackString( const uint8** ppCursor, const uint8* pEnd, hpack_buffer* pScratch, const char** ppString, size_t* pStringLength )
+    {
+        if ( *ppCursor == pEnd )
+        {
+            return error_id::parse_error;
+        }
+
+        const bool             isHuffmanEncoded = ( **ppCursor & 0x80u ) != 0u;
+        const result< uint32 > lengthResult     = decodeHpackInteger( ppCursor, pEnd, 7u );
+        if ( lengthResult.hasError() )
+        {
+            return lengthResult.getError();
+        }
+
+        const uint32 length = lengthResult.getValue();
+        if ( ( size_t )( pEnd - *ppCursor ) < length )
+        {
+            return error_id::parse_error;
+        }
+
+        const size_t stringStart = pScratch->size;
+        if ( isHuffmanEncoded )
+        {
+            const result< void > huffmanResult = decodeHpackHuffmanString( pScratch, *ppCursor, length );
+            if ( huffmanResult.hasError() )
+            {
+                return huffmanResult;
+            }
+        }
+        else if ( !writeToHpackBuffer( pScratch, *ppCursor, length ) )
+        {
+            return error_id::out_of_memory;
+        }
+
+        *ppCursor += length;
+        *ppString      = ( const char* )pScratch->pData + stringStart;
+        *pStringLength = pScratch->size - stringStart;
+        return error_id::success;
+    }
+
+    bool encodeHpackString( hpack_buffer* pBuffer, const char* pString, size_t stringLength )
+    {
+        const size_t huffmanLength = getHpackHuffmanEncodedLength( pString, stringLength );
+        if ( huffmanLength < stringLength )
+        {
+            return encodeHpackInteger( pBuffer, 0x80u, 7u, ( uint32 )huffmanLength ) && encodeHpackHuffmanString( pBuffer, pString, stringLength );
+        }
+
+        return encodeHpackInteger( pBuffer, 0x00u, 7u, ( uint32 )stringLength ) && writeToHpackBuffer( pBuffer, pString, stringLength );
+    }
+
+    void initializeHpackDecoder( hpack_decoder* pDecoder, char* pStorage, hpack_dynamic_table_entry* pEntries, size_t maxSize )
+    {
+        initializeHpackDynamicTable( &pDecoder->table, pStorage, pEntries, maxSize );
+        pDecoder->maxSizeLimit = maxSize;
+    }
+
+    result< void > decodeHpackHeaderBlock( hpack_decoder* pDecoder, const uint8* pBlock, size_t blockSizeInBytes, hpack_buffer* pScratch, hpack_header_callback pCallback, void* pUserData )
+    {
+        const uint8* pCursor = pBlock;
+        const uint8* pEnd    = pBlock + blockSizeInBytes;
+
+        bool headerFieldSeen = false;
+        while ( pCursor != pEnd )
+        {
+            const uint8 firstByte = *pCursor;
+
+            if ( ( firstByte & 0xE0u ) == 0x20u )
+            {
+                //FK: Dynamic table size update, only allowed at the start of a header block
+                const result< uint32 > sizeResult = decodeHpackInteger( &pCursor, pEnd, 5u );
+                if ( sizeResult.hasError() || headerFieldSeen || sizeResult.getValue() > pDecoder->maxSizeLimit )
+                {
+                    return error_id::parse_error;
+                }
+
+                setHpackDynamicTableMaxSize( &pDecoder->table, sizeResult.getValue() );
+                continue;
+            }
+
+            headerFieldSeen = true;
+
+            hpack_header_field field;
+            if ( firstByte & 0x80u )
+            {
+                //FK: Indexed header field
+                const result< uint32 > indexResult = decodeHpackInteger( &pCursor, pEnd, 7u );
+                hpack_header_field     tableField;
+                if ( indexResult.hasError() || !getHpackTableEntry( &pDecoder->table, indexResult.getValue(), &tableField ) )
+                {
+                    return error_id::parse_error;
+                }
+
+                field.pName       = ( const char* )pScratch->pData + pScratch->size;
+                field.nameLength  = tableField.nameLength;
+                field.pValue      = field.pName + tableField.nameLength;
+                field.valueLength = tableField.valueLength;
+                if ( !writeToHpackBuffer( pScratch, tableField.pName, tableField.nameLength ) || !writeToHpackBuffer( pScratch, tableField.pValue, tableField.valueLength ) )
+                {
+                    return error_id::out_of_memory;
+                }
+
+                pCallback( pUserData, field );
+                continue;
+            }
+
+            const bool  addToTable = ( firstByte & 0xC0u ) == 0x40u;
+            const uint8 prefixBits = addToTable ? 6u : 4u;
+
+            const result< uint32 > nameIndexResult = decodeHpackInteger( &pCursor, pEnd, prefixBits );
+            if ( nameIndexResult.hasError() )
+            {
+                return nameIndexResult.getError();
+            }
+
+            if ( nameIndexResult.getValue() == 0u )
+            {
+                const result< void > nameResult = decodeHpackString( &pCursor, pEnd, pScratch, &field.pName, &field.nameLength );
+                if ( nameResult.hasError() )
+                {
+                    return nameResult;
+                }
+            }
+            else
+            {
+                hpack_header_field tableField;
+                if ( !getHpackTableEntry( &pDecoder->table, nameIndexResult.getValue(), &tableField ) )
+                {
+                    return error_id::parse_error;
+                }
+
+                field.pName      = ( const char* )pScratch->pData + pScratch->size;
+                field.nameLength = tableField.nameLength;
+                if ( !writeToHpackBuffer( pScratch, tableField.pName, tableField.nameLength ) )
+                {
+                    return error_id::out_of_memory;
+                }
+            }
+
+            const result< void > valueResult = decodeHpackString( &pCursor, pEnd, pScratch, &field.pValue, &field.valueLength );
+            if ( valueResult.hasError() )
+            {
+                return valueResult;
+            }
+
+            if ( addToTable )
+            {
+                addHpackDynamicTableEntry( &pDecoder->table, field.pName, field.nameLength, field.pValue, field.valueLength );
+            }
+
+            pCallback( pUserData, field );
+        }
+
+        return error_id::success;
+    }
+
+    void initializeHpackEncoder( hpack_encoder* pEncoder, char* pStorage, hpack_dynamic_table_entry* pEntries, size_t maxSize )
+    {
+        initializeHpackDynamicTable( &pEncoder->table, pStorage, pEntries, maxSize );
+        pEncoder->pendingMaxSize          = maxSize;
+        pEncoder->hasPendingMaxSizeUpdate = false;
+    }
+
+    //FK: Called when the peer changes SETTINGS_HEADER_TABLE_SIZE, the size update gets emitted with the next header block
+    void setHpackEncoderMaxSize( hpack_encoder* pEncoder, size_t peerMaxSize )
+    {
+        const size_t maxSize = peerMaxSize < pEncoder->table.storageCapacity ? peerMaxSize : pEncoder->table.storageCapacity;
+        if ( maxSize == pEncoder->table.maxSize )
+        {
+            return;
+        }
+
+        setHpackDynamicTableMaxSize( &pEncoder->table, maxSize );
+        pEncoder->pendingMaxSize          = maxSize;
+        pEncoder->hasPendingMaxSizeUpdate = true;
+    }
+
+    bool encodeHpackHeaderField( hpack_encoder* pEncoder, hpack_buffer* pBuffer, const char* pName, const char* pValue, size_t valueLength, hpack_indexing indexing )
+    {
+        if ( pEncoder->hasPendingMaxSizeUpdate )
+        {
+            if ( !encodeHpackInteger( pBuffer, 0x20u, 5u, ( uint32 )pEncoder->pendingMaxSize ) )
+            {
+                return false;
+            }
+
+            pEncoder->hasPendingMaxSizeUpdate = false;
+        }
+
+        const size_t nameLength  = strlen( pName );
+        bool         isFullMatch = false;
+        const size_t tableIndex  = findHpackTableEntry( &pEncoder->table, pName, nameLength, pValue, valueLength, &isFullMatch );
+        if ( isFullMatch )
+        {
+            return encodeHpackInteger( pBuffer, 0x80u, 7u, ( uint32 )tableIndex );
+        }
+
+        uint8 firstByteFlags = 0x00u;
+        uint8 prefixBits     = 4u;
+        switch ( indexing )
+        {
+        case hpack_indexing::incremental:
+            firstByteFlags = 0x40u;
+            prefixBits     = 6u;
+            break;
+        case hpack_indexing::without: firstByteFlags = 0x00u; break;
+        case hpack_indexing::never: firstByteFlags = 0x10u; break;
+        }
+
+        const bool encoded = encodeHpackInteger( pBuffer, firstByteFlags, prefixBits, ( uint32 )tableIndex ) &&
+                             ( tableIndex != 0u || encodeHpackString( pBuffer, pName, nameLength ) ) &&
+                             encodeHpackString( pBuffer, pValue, valueLength );
+
+        if ( encoded && indexing == hpack_indexing::incremental )
+        {
+            addHpackDynamicTableEntry( &pEncoder->table, pName, nameLength, pValue, valueLength );
+        }
+
+        return encoded;
+    }
+
+    bool encodeHpackHeaderField( hpack_encoder* pEncoder, hpack_buffer* pBuffer, const char* pName, const char* pValue, hpack_indexing indexing )
+    {
+        return encodeHpackHeaderField( pEncoder, pBuffer, pName, pValue, strlen( pValue ), indexing );
+    }
+} // namespace k15
+
+#endif //K15_HPACK_INCLUDE
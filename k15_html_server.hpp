@@ -7,13 +7,20 @@
 #include "k15_std/include/k15_path.hpp"
 #include "k15_std/include/k15_io.hpp"
 
+#include "k15_socket.hpp"
+#include "k15_directory_listing.hpp"
+#include "k15_server_status.hpp"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
 namespace k15
 {
-    typedef int socketId;
-
     enum class html_server_flag
     {
-        only_serve_below_root = 0
+        only_serve_below_root  = 0,
+        auto_index_directories = 1
     };
 
     using html_server_flags = bitmask8< html_server_flag >;
@@ -27,6 +34,9 @@ namespace k15
         string_view       rootDirectory;
         int               port;
 
+        directory_listing_cache* pDirectoryListingCache;
+        const k15_status_board*  pStatusBoard; //FK: nullptr disables /api/servers
+
         html_server_flags flags;
     };
 
@@ -48,14 +58,20 @@ namespace k15
     {
         ok,
         not_found,
-        bad_request
+        bad_request,
+        uri_too_long
     };
 
-    enum : uint8
+    enum : uint32
     {
-        HtmlRequestPathLength = 128
+        HtmlRequestPathLength = DirectoryListingLineLength, //FK: Every href the directory listing renders has to fit
+        HtmlChunkSize         = 16u * 1024u,
+        HtmlChunkHeaderSize   = 16u //FK: hex chunk size + CRLF
     };
 
+    //FK: Writes up to bufferSizeInBytes of body into pBuffer, returning 0 ends the response
+    typedef result< size_t > ( *html_chunk_producer )( void* pUserData, char* pBuffer, size_t bufferSizeInBytes );
+
     struct html_request
     {
         request_method method;
@@ -64,29 +80,57 @@ namespace k15
 
     struct html_server_parameters
     {
-        memory_allocator* pAllocator;
-        int               port;
-        const char*       pIpv4BindAddress;
-        const char*       pIpv6BindAddress;
-        const char*       pRootDirectory;
-        const char*       pLogFilePath;
-        bool              onlyServeBelowRoot; //FK: Don't allow paths like ../file.txt
+        memory_allocator*       pAllocator;
+        int                     port;
+        const char*             pIpv4BindAddress;
+        const char*             pIpv6BindAddress;
+        const char*             pRootDirectory;
+        const char*             pLogFilePath;
+        bool                    onlyServeBelowRoot;   //FK: Don't allow paths like ../file.txt
+        bool                    autoIndexDirectories; //FK: Generate a listing for directories without index file
+        const k15_status_board* pStatusBoard;         //FK: Optional, rendered by /api/servers
     };
 
     bool listenOnSocket( const socketId& socket, int protocol, int port, const char* bindAddress )
     {
-        if ( socket == INVALID_SOCKET )
+        if ( socket == invalidSocket )
         {
             return false;
         }
 
-        sockaddr_in sockAddr;
-        sockAddr.sin_family      = protocol;
-        sockAddr.sin_port        = htons( port );
-        sockAddr.sin_addr.s_addr = inet_addr( bindAddress );
+        //FK: Allow a restarted daemon to rebind while old connections are still in TIME_WAIT
+        setSocketOption( socket, SOL_SOCKET, SO_REUSEADDR, 1 );
+
+        int bindResult = socketError;
+        if ( protocol == AF_INET6 )
+        {
+            //FK: Otherwise the ipv6 socket also claims the ipv4 port on linux and the second bind fails
+            setSocketOption( socket, IPPROTO_IPV6, IPV6_V6ONLY, 1 );
+
+            sockaddr_in6 sockAddr = {};
+            sockAddr.sin6_family  = AF_INET6;
+            sockAddr.sin6_port    = htons( ( uint16 )port );
+            if ( inet_pton( AF_INET6, bindAddress, &sockAddr.sin6_addr ) != 1 )
+            {
+                return false;
+            }
+
+            bindResult = bind( socket, ( const struct sockaddr* )&sockAddr, sizeof( sockAddr ) );
+        }
+        else
+        {
+            sockaddr_in sockAddr = {};
+            sockAddr.sin_family  = AF_INET;
+            sockAddr.sin_port    = htons( ( uint16 )port );
+            if ( inet_pton( AF_INET, bindAddress, &sockAddr.sin_addr ) != 1 )
+            {
+                return false;
+            }
+
+            bindResult = bind( socket, ( const struct sockaddr* )&sockAddr, sizeof( sockAddr ) );
+        }
 
-        const int bindResult = bind( socket, ( const struct sockaddr* )&sockAddr, sizeof( sockAddr ) );
-        if ( bindResult == SOCKET_ERROR )
+        if ( bindResult == socketError )
         {
             return false;
         }
@@ -94,7 +138,7 @@ namespace k15
         const int backlog      = 10; //FK: TODO: find reasonable number here
         const int listenResult = listen( socket, backlog );
 
-        if ( listenResult == SOCKET_ERROR )
+        if ( listenResult == socketError )
         {
             return false;
         }
@@ -106,26 +150,42 @@ namespace k15
     {
         fd_set readSockets;
         FD_ZERO( &readSockets );
-        FD_SET( pServer->ipv4Socket, &readSockets );
-        FD_SET( pServer->ipv6Socket, &readSockets );
+        if ( pServer->ipv4Socket != invalidSocket )
+        {
+            FD_SET( pServer->ipv4Socket, &readSockets );
+        }
 
-        const int selectResult = select( 0, &readSockets, nullptr, nullptr, nullptr );
-        if ( selectResult == -1 )
+        if ( pServer->ipv6Socket != invalidSocket )
+        {
+            FD_SET( pServer->ipv6Socket, &readSockets );
+        }
+
+        const int descriptorCount = getSelectDescriptorCount( pServer->ipv4Socket, pServer->ipv6Socket );
+        const int selectResult    = select( descriptorCount, &readSockets, nullptr, nullptr, nullptr );
+        if ( selectResult == socketError )
         {
             return nullptr;
         }
 
-        html_client* pClient = newObject< html_client >( pServer->pAllocator );
-        pClient->pAllocator  = pServer->pAllocator;
-        if ( FD_ISSET( pServer->ipv4Socket, &readSockets ) )
+        socketId clientSocket = invalidSocket;
+        if ( pServer->ipv4Socket != invalidSocket && FD_ISSET( pServer->ipv4Socket, &readSockets ) )
         {
-            pClient->socket = accept( pServer->ipv4Socket, NULL, NULL );
+            clientSocket = accept( pServer->ipv4Socket, NULL, NULL );
         }
-        else
+        else if ( pServer->ipv6Socket != invalidSocket && FD_ISSET( pServer->ipv6Socket, &readSockets ) )
         {
-            pClient->socket = accept( pServer->ipv6Socket, NULL, NULL );
+            clientSocket = accept( pServer->ipv6Socket, NULL, NULL );
         }
 
+        if ( clientSocket == invalidSocket )
+        {
+            return nullptr;
+        }
+
+        html_client* pClient = newObject< html_client >( pServer->pAllocator );
+        pClient->pAllocator  = pServer->pAllocator;
+        pClient->socket      = clientSocket;
+
         return pClient;
     }
 
@@ -134,10 +194,15 @@ namespace k15
         while ( true )
         {
             char      buffer[ 256 ];
-            const int bytesRead = recv( pClient->socket, buffer, 256, 0u );
+            const int bytesRead = receiveFromSocket( pClient->socket, buffer, sizeof( buffer ) );
 
-            if ( bytesRead == -1 )
+            if ( bytesRead == socketError )
             {
+                if ( isTransientSocketError( getLastSocketError() ) )
+                {
+                    continue;
+                }
+
                 return error_id::socket_error;
             }
             else if ( bytesRead == 0 )
@@ -164,6 +229,95 @@ namespace k15
         return error_id::success;
     }
 
+    int getHexDigitValue( char character )
+    {
+        if ( character >= '0' && character <= '9' ) return character - '0';
+        if ( character >= 'a' && character <= 'f' ) return character - 'a' + 10;
+        if ( character >= 'A' && character <= 'F' ) return character - 'A' + 10;
+        return -1;
+    }
+
+    //FK: Appends a decoded character to the path, empty ('//') and '.' segments are dropped on the way
+    //    so that eg. '//logs/' and '/./logs/' become '/logs/' (a leading '//' would be a protocol relative url)
+    char* appendToDecodedUrlPath( char* pPath, char* pTarget, char character )
+    {
+        if ( character == '/' )
+        {
+            if ( pTarget > pPath && pTarget[ -1 ] == '/' )
+            {
+                return pTarget;
+            }
+
+            if ( pTarget - pPath >= 2 && pTarget[ -1 ] == '.' && pTarget[ -2 ] == '/' )
+            {
+                return pTarget - 1;
+            }
+        }
+
+        *pTarget = character;
+        return pTarget + 1;
+    }
+
+    //FK: Decodes %XX escapes in place, normalizes the separators (see appendToDecodedUrlPath) and cuts off the query string.
+    //    Returns false if the path decodes to an embedded NUL, which would silently cut it short
+    bool decodeUrlPath( char* pPath )
+    {
+        char* pTarget = pPath;
+        for ( const char* pSource = pPath; *pSource != 0 && *pSource != '?'; ++pSource )
+        {
+            if ( pSource[ 0 ] == '%' && pSource[ 1 ] != 0 && pSource[ 2 ] != 0 )
+            {
+                const int highNibble = getHexDigitValue( pSource[ 1 ] );
+                const int lowNibble  = getHexDigitValue( pSource[ 2 ] );
+                if ( highNibble != -1 && lowNibble != -1 )
+                {
+                    if ( highNibble == 0 && lowNibble == 0 )
+                    {
+                        return false;
+                    }
+
+                    pTarget = appendToDecodedUrlPath( pPath, pTarget, ( char )( ( highNibble << 4 ) | lowNibble ) );
+                    pSource += 2;
+                    continue;
+                }
+            }
+
+            pTarget = appendToDecodedUrlPath( pPath, pTarget, *pSource );
+        }
+
+        //FK: trailing '/.'
+        if ( pTarget - pPath >= 2 && pTarget[ -1 ] == '.' && pTarget[ -2 ] == '/' )
+        {
+            --pTarget;
+        }
+
+        *pTarget = 0;
+        return true;
+    }
+
+    //FK: Checks the decoded path for '..' segments, '\\' counts as separator as well since win32 accepts both
+    bool isRequestPathBelowRoot( const char* pPath )
+    {
+        const char* pSegmentStart = pPath;
+        for ( const char* pChar = pPath;; ++pChar )
+        {
+            if ( *pChar == '/' || *pChar == '\\' || *pChar == 0 )
+            {
+                if ( pChar - pSegmentStart == 2 && pSegmentStart[ 0 ] == '.' && pSegmentStart[ 1 ] == '.' )
+                {
+                    return false;
+                }
+
+                if ( *pChar == 0 )
+                {
+                    return true;
+                }
+
+                pSegmentStart = pChar + 1;
+            }
+        }
+    }
+
     result< html_request > parseHtmlRequest( slice< char >* pMessageBuffer )
     {
         html_request request;
@@ -237,10 +391,18 @@ namespace k15
                     }
 
                     const size_t pathLength = pPathEnd - pPathBegin;
-                    K15_ASSERT( pathLength < HtmlRequestPathLength );
+                    if ( pathLength >= HtmlRequestPathLength )
+                    {
+                        //FK: Reported as 414 by serveHtmlClients
+                        return error_id::out_of_memory;
+                    }
 
                     copyMemoryNonOverlapping( request.path, HtmlRequestPathLength, pPathBegin, pathLength );
                     request.path[ pathLength ] = 0;
+                    if ( !decodeUrlPath( request.path ) )
+                    {
+                        return error_id::parse_error;
+                    }
 
                     state = parse_state::finished;
                     break;
@@ -251,32 +413,70 @@ namespace k15
         return request;
     }
 
-    result< html_request > readClientRequest( html_client* pClient )
+    //FK: Finds the value of a request header (name is matched case insensitive), the value is not zero terminated
+    bool findHttpHeaderValue( const char* pMessage, const char* pHeaderName, const char** ppValue, size_t* pValueLength )
     {
-        //html_request request;
-        //dynamic_array< char, 256u > messageBuffer;
-        dynamic_array< char > messageBuffer( pClient->pAllocator );
-        const result< void >  receiveResult = receiveClientData( &messageBuffer, pClient );
-        if ( receiveResult.hasError() )
+        const size_t headerNameLength = strlen( pHeaderName );
+        const char*  pLine            = strchr( pMessage, '\n' );
+
+        while ( pLine != nullptr )
         {
-            return receiveResult.getError();
+            ++pLine;
+            if ( *pLine == '\r' || *pLine == '\n' || *pLine == 0 )
+            {
+                //FK: Empty line, end of the header section
+                break;
+            }
+
+            bool nameMatches = pLine[ headerNameLength ] == ':';
+            for ( size_t charIndex = 0u; nameMatches && charIndex < headerNameLength; ++charIndex )
+            {
+                nameMatches = tolower( ( unsigned char )pLine[ charIndex ] ) == tolower( ( unsigned char )pHeaderName[ charIndex ] );
+            }
+
+            if ( nameMatches )
+            {
+                const char* pValue = pLine + headerNameLength + 1u;
+                while ( *pValue == ' ' || *pValue == '\t' )
+                {
+                    ++pValue;
+                }
+
+                const char* pValueEnd = pValue;
+                while ( *pValueEnd != 0 && *pValueEnd != '\r' && *pValueEnd != '\n' )
+                {
+                    ++pValueEnd;
+                }
+
+                *ppValue      = pValue;
+                *pValueLength = pValueEnd - pValue;
+                return true;
+            }
+
+            pLine = strchr( pLine, '\n' );
         }
 
-        return parseHtmlRequest( &messageBuffer );
+        return false;
     }
 
     void destroyHtmlServer( html_server* pServer )
     {
-        if ( pServer->ipv4Socket != INVALID_SOCKET )
+        if ( pServer->ipv4Socket != invalidSocket )
+        {
+            closeSocket( pServer->ipv4Socket );
+            pServer->ipv4Socket = invalidSocket;
+        }
+
+        if ( pServer->ipv6Socket != invalidSocket )
         {
-            closesocket( pServer->ipv4Socket );
-            pServer->ipv4Socket = INVALID_SOCKET;
+            closeSocket( pServer->ipv6Socket );
+            pServer->ipv6Socket = invalidSocket;
         }
 
-        if ( pServer->ipv6Socket != INVALID_SOCKET )
+        if ( pServer->pDirectoryListingCache != nullptr )
         {
-            closesocket( pServer->ipv6Socket );
-            pServer->ipv6Socket = INVALID_SOCKET;
+            deleteObject( pServer->pDirectoryListingCache, pServer->pAllocator );
+            pServer->pDirectoryListingCache = nullptr;
         }
 
         deleteObject( pServer, pServer->pAllocator );
@@ -306,24 +506,62 @@ namespace k15
         pServer->port          = parameters.port;
         pServer->pAllocator    = pAllocator;
         pServer->logFileHandle = logFileHandle;
+        pServer->pStatusBoard  = parameters.pStatusBoard;
+
+        pServer->pDirectoryListingCache = nullptr;
+        if ( parameters.autoIndexDirectories )
+        {
+            pServer->pDirectoryListingCache = newObject< directory_listing_cache >( pAllocator );
+            if ( pServer->pDirectoryListingCache == nullptr || !createDirectoryListingCache( pServer->pDirectoryListingCache, pAllocator ) )
+            {
+                destroyHtmlServer( pServer );
+                return error_id::out_of_memory;
+            }
+        }
 
-        if ( pServer->ipv4Socket == INVALID_SOCKET && pServer->ipv6Socket == INVALID_SOCKET )
+        if ( pServer->ipv4Socket == invalidSocket && pServer->ipv6Socket == invalidSocket )
         {
             destroyHtmlServer( pServer );
             return error_id::socket_error;
         }
 
-        if ( !listenOnSocket( pServer->ipv4Socket, AF_INET, parameters.port, parameters.pIpv4BindAddress ) && !listenOnSocket( pServer->ipv6Socket, AF_INET6, parameters.port, parameters.pIpv6BindAddress ) )
+        //FK: A socket that isn't listening shows up as readable in select() forever, so drop every family that failed
+        if ( pServer->ipv4Socket != invalidSocket && !listenOnSocket( pServer->ipv4Socket, AF_INET, parameters.port, parameters.pIpv4BindAddress ) )
+        {
+            closeSocket( pServer->ipv4Socket );
+            pServer->ipv4Socket = invalidSocket;
+        }
+
+        if ( pServer->ipv6Socket != invalidSocket && !listenOnSocket( pServer->ipv6Socket, AF_INET6, parameters.port, parameters.pIpv6BindAddress ) )
+        {
+            closeSocket( pServer->ipv6Socket );
+            pServer->ipv6Socket = invalidSocket;
+        }
+
+        if ( pServer->ipv4Socket == invalidSocket && pServer->ipv6Socket == invalidSocket )
         {
             destroyHtmlServer( pServer );
             return error_id::listen_error;
         }
 
         pServer->flags.setIf( html_server_flag::only_serve_below_root, parameters.onlyServeBelowRoot );
+        pServer->flags.setIf( html_server_flag::auto_index_directories, parameters.autoIndexDirectories );
 
         return pServer;
     }
 
+    bool copyPathToBuffer( char* pBuffer, size_t bufferSizeInBytes, const string_view& pathToCopy )
+    {
+        if ( pathToCopy.getLength() >= bufferSizeInBytes )
+        {
+            return false;
+        }
+
+        copyMemoryNonOverlapping( pBuffer, bufferSizeInBytes, pathToCopy.getStart(), pathToCopy.getLength() );
+        pBuffer[ pathToCopy.getLength() ] = 0;
+        return true;
+    }
+
     result< void > findIndexFileInDirectory( path* pTarget, memory_allocator* pAllocator, const string_view& servePath )
     {
         K15_ASSERT( pTarget != nullptr );
@@ -353,36 +591,79 @@ namespace k15
         return error_id::not_found;
     }
 
-    result< void > sendToClient( html_client* pClient, const array_view< char >& content )
+    enum class html_request_target
     {
-        WSASetLastError( 0u );
-        const int bytesSend = send( pClient->socket, ( const char* )content.getStart(), content.getSize(), 0u );
-        if ( bytesSend != SOCKET_ERROR )
+        file,
+        directory_listing,
+        server_status,
+        not_found
+    };
+
+    //FK: Maps a request path to what should be served, pServePath receives the file or directory path
+    html_request_target resolveRequestTarget( html_server* pServer, const char* pRequestPath, path* pServePath )
+    {
+        if ( pServer->flags.isSet( html_server_flag::only_serve_below_root ) && !isRequestPathBelowRoot( pRequestPath ) )
+        {
+            return html_request_target::not_found;
+        }
+
+        if ( pServer->pStatusBoard != nullptr && strcmp( pRequestPath, serverStatusApiPath ) == 0 )
+        {
+            return html_request_target::server_status;
+        }
+
+        if ( !pServePath->setCombinedPath( pServer->rootDirectory, pRequestPath ) )
         {
-            return error_id::success;
+            return html_request_target::not_found;
         }
 
-        const int wsaError = WSAGetLastError();
-        K15_UNUSED_VARIABLE( wsaError );
-        K15_NOT_IMPLEMENTED;
+        if ( pServePath->isDirectory() )
+        {
+            const result< void > indexFilePathResult = findIndexFileInDirectory( pServePath, pServer->pAllocator, *pServePath );
+            if ( indexFilePathResult.isOk() )
+            {
+                return html_request_target::file;
+            }
 
-        return error_id::generic;
+            return pServer->flags.isSet( html_server_flag::auto_index_directories ) ? html_request_target::directory_listing : html_request_target::not_found;
+        }
+
+        return doesFileExist( *pServePath ) ? html_request_target::file : html_request_target::not_found;
     }
 
-    result< void > sendToClient( html_client* pClient, char character )
+    result< void > sendToClient( html_client* pClient, const char* pData, size_t dataSizeInBytes )
     {
-        WSASetLastError( 0u );
-        const int bytesSend = send( pClient->socket, &character, 1u, 0u );
-        if ( bytesSend != SOCKET_ERROR )
+        //FK: send() may accept only part of the buffer, keep going until everything is out
+        while ( dataSizeInBytes > 0u )
         {
-            return error_id::success;
+            clearLastSocketError();
+            const int bytesSend = sendOnSocket( pClient->socket, pData, dataSizeInBytes );
+            if ( bytesSend == socketError )
+            {
+                //FK: Client sockets are blocking, EAGAIN only shows up if a send timeout expired
+                if ( isInterruptedSocketError( getLastSocketError() ) )
+                {
+                    continue;
+                }
+
+                return error_id::socket_error;
+            }
+
+            pData += bytesSend;
+            dataSizeInBytes -= ( size_t )bytesSend;
         }
 
-        const int wsaError = WSAGetLastError();
-        K15_UNUSED_VARIABLE( wsaError );
-        K15_NOT_IMPLEMENTED;
+        return error_id::success;
+    }
 
-        return error_id::generic;
+    result< void > sendToClient( html_client* pClient, const array_view< char >& content )
+    {
+        return sendToClient( pClient, ( const char* )content.getStart(), content.getSize() );
+    }
+
+    result< void > sendToClient( html_client* pClient, char character )
+    {
+        return sendToClient( pClient, &character, 1u );
     }
 
     result< void > sendStatusCodeToClient( html_client* pClient, http_status_code statusCode )
@@ -410,6 +691,13 @@ namespace k15
                 const char message[] = {
                     "HTTP/1.1 400 Bad Request\n" };
 
+                return sendToClient( pClient, createArrayView( message ) );
+            }
+        case http_status_code::uri_too_long:
+            {
+                const char message[] = {
+                    "HTTP/1.1 414 URI Too Long\n" };
+
                 return sendToClient( pClient, createArrayView( message ) );
             }
         }
@@ -458,12 +746,123 @@ namespace k15
         return sendToClient( pClient, "\0\n" );
     }
 
+    //FK: Streams the body with Transfer-Encoding: chunked, so generated content never has to be buffered completely
+    result< void > sendChunkedResponseToClient( html_client* pClient, const char* pContentType, html_chunk_producer pProducer, void* pUserData )
+    {
+        char      header[ 256 ];
+        const int headerLength = snprintf( header, sizeof( header ),
+                                           "HTTP/1.1 200 OK\r\n"
+                                           "Content-Type: %s\r\n"
+                                           "Transfer-Encoding: chunked\r\n"
+                                           "Connection: close\r\n\r\n",
+                                           pContentType );
+
+        if ( headerLength < 0 || headerLength >= ( int )sizeof( header ) )
+        {
+            return error_id::generic;
+        }
+
+        const result< void > headerResult = sendToClient( pClient, header, ( size_t )headerLength );
+        if ( headerResult.hasError() )
+        {
+            return headerResult;
+        }
+
+        //FK: The producer writes behind the space reserved for the chunk size line so every chunk goes out with a single send()
+        char chunkBuffer[ HtmlChunkHeaderSize + HtmlChunkSize + 2u ];
+        while ( true )
+        {
+            const result< size_t > produceResult = pProducer( pUserData, chunkBuffer + HtmlChunkHeaderSize, HtmlChunkSize );
+            if ( produceResult.hasError() )
+            {
+                //FK: No terminating chunk, the client has to treat the response as truncated
+                return produceResult.getError();
+            }
+
+            const size_t chunkSize = produceResult.getValue();
+            if ( chunkSize == 0u )
+            {
+                break;
+            }
+
+            char      chunkSizeLine[ HtmlChunkHeaderSize ];
+            const int chunkSizeLineLength = snprintf( chunkSizeLine, sizeof( chunkSizeLine ), "%zx\r\n", chunkSize );
+            char*     pChunkStart         = chunkBuffer + HtmlChunkHeaderSize - chunkSizeLineLength;
+
+            copyMemoryNonOverlapping( pChunkStart, chunkSizeLineLength, chunkSizeLine, chunkSizeLineLength );
+            chunkBuffer[ HtmlChunkHeaderSize + chunkSize ]      = '\r';
+            chunkBuffer[ HtmlChunkHeaderSize + chunkSize + 1u ] = '\n';
+
+            const result< void > sendResult = sendToClient( pClient, pChunkStart, chunkSizeLineLength + chunkSize + 2u );
+            if ( sendResult.hasError() )
+            {
+                return sendResult;
+            }
+        }
+
+        const char lastChunk[] = "0\r\n\r\n";
+        return sendToClient( pClient, lastChunk, sizeof( lastChunk ) - 1u );
+    }
+
+    result< void > sendDirectoryListingToClient( html_server* pServer, html_client* pClient, const string_view& directoryPath, const char* pRequestPath )
+    {
+        char directoryPathBuffer[ DirectoryPathLength ];
+        if ( !copyPathToBuffer( directoryPathBuffer, DirectoryPathLength, directoryPath ) )
+        {
+            return error_id::not_found;
+        }
+
+        directory_listing_stream* pStream = newObject< directory_listing_stream >( pServer->pAllocator );
+        if ( pStream == nullptr )
+        {
+            return error_id::out_of_memory;
+        }
+
+        const result< void > openResult = openDirectoryListingStream( pStream, pServer->pDirectoryListingCache, directoryPathBuffer, pRequestPath );
+        if ( openResult.hasError() )
+        {
+            //FK: Nothing has been sent yet, so every failure to open the listing turns into a 404
+            deleteObject( pStream, pServer->pAllocator );
+            return error_id::not_found;
+        }
+
+        const result< void > sendResult = sendChunkedResponseToClient( pClient, "text/html; charset=utf-8", produceDirectoryListingChunk, pStream );
+
+        closeDirectoryListingStream( pStream );
+        deleteObject( pStream, pServer->pAllocator );
+
+        return sendResult;
+    }
+
+    result< void > sendServerStatusToClient( html_server* pServer, html_client* pClient )
+    {
+        server_status_document* pDocument = newObject< server_status_document >( pServer->pAllocator );
+        if ( pDocument == nullptr )
+        {
+            return error_id::out_of_memory;
+        }
+
+        result< void > sendResult = renderServerStatusDocument( pDocument, pServer->pStatusBoard );
+        if ( sendResult.isOk() )
+        {
+            sendResult = sendChunkedResponseToClient( pClient, "application/json", produceServerStatusChunk, pDocument );
+        }
+
+        deleteObject( pDocument, pServer->pAllocator );
+        return sendResult;
+    }
+
     void closeClientConnection( html_server* pServer, html_client* pClient )
     {
-        closesocket( pClient->socket );
+        closeSocket( pClient->socket );
         deleteObject( pClient, pServer->pAllocator );
     }
 
+    //FK: Defined in k15_http2.hpp
+    bool isHttp2ConnectionPreface( const char* pData, size_t dataSizeInBytes );
+    bool isHttp2UpgradeRequest( const char* pMessage );
+    void serveHttp2Client( html_server* pServer, html_client* pClient, const char* pReceivedData, size_t receivedDataSizeInBytes, const html_request* pUpgradeRequest );
+
     bool serveHtmlClients( html_server* pServer )
     {
         while ( true )
@@ -474,32 +873,59 @@ namespace k15
                 continue;
             }
 
-            const result< html_request > requestResult = readClientRequest( pClient );
-            if ( requestResult.hasError() )
+            dynamic_array< char > messageBuffer( pClient->pAllocator );
+            const result< void >  receiveResult = receiveClientData( &messageBuffer, pClient );
+            if ( receiveResult.hasError() )
             {
                 sendStatusCodeToClient( pClient, http_status_code::bad_request );
                 closeClientConnection( pServer, pClient );
                 continue;
             }
 
+            //FK: -1 for the zero terminator added by receiveClientData
+            if ( isHttp2ConnectionPreface( messageBuffer.getStart(), messageBuffer.getSize() - 1u ) )
+            {
+                serveHttp2Client( pServer, pClient, messageBuffer.getStart(), messageBuffer.getSize() - 1u, nullptr );
+                closeClientConnection( pServer, pClient );
+                continue;
+            }
+
+            const result< html_request > requestResult = parseHtmlRequest( &messageBuffer );
+            if ( requestResult.hasError() )
+            {
+                sendStatusCodeToClient( pClient, requestResult.getError() == error_id::out_of_memory ? http_status_code::uri_too_long : http_status_code::bad_request );
+                closeClientConnection( pServer, pClient );
+                continue;
+            }
+
             const html_request& request = requestResult.getValue();
             switch ( request.method )
             {
             case request_method::get:
                 {
-                    path servePath( pServer->pAllocator );
-                    servePath.setCombinedPath( pServer->rootDirectory, request.path );
+                    if ( isHttp2UpgradeRequest( messageBuffer.getStart() ) )
+                    {
+                        serveHttp2Client( pServer, pClient, messageBuffer.getStart(), messageBuffer.getSize() - 1u, &request );
+                        closeClientConnection( pServer, pClient );
+                        break;
+                    }
 
-                    if ( servePath.isDirectory() )
+                    path                      servePath( pServer->pAllocator );
+                    const html_request_target target = resolveRequestTarget( pServer, request.path, &servePath );
+
+                    if ( target == html_request_target::directory_listing )
                     {
-                        const result< void > indexFilePathResult = findIndexFileInDirectory( &servePath, pServer->pAllocator, servePath );
-                        if ( indexFilePathResult.hasError() )
+                        const result< void > listingResult = sendDirectoryListingToClient( pServer, pClient, servePath, request.path );
+                        if ( listingResult.getError() == error_id::not_found )
                         {
-                            return false;
+                            sendStatusCodeToClient( pClient, http_status_code::not_found );
                         }
                     }
-
-                    if ( !doesFileExist( servePath ) )
+                    else if ( target == html_request_target::server_status )
+                    {
+                        sendServerStatusToClient( pServer, pClient );
+                    }
+                    else if ( target == html_request_target::not_found )
                     {
                         sendStatusCodeToClient( pClient, http_status_code::not_found );
                     }
@@ -520,4 +946,6 @@ namespace k15
     }
 } // namespace k15
 
+#include "k15_http2.hpp"
+
 #endif //K15_HTML_SERVER_INCLUDE
\ No newline at end of file
@@ -0,0 +1,1484 @@
+#ifndef K15_HTTP2_INCLUDE
+#define K15_HTTP2_INCLUDE
+
+#include "k15_html_server.hpp"
+#include "k15_hpack.hpp"
+
+#if !defined( _WIN32 )
+#    include <sys/stat.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+namespace k15
+{
+    enum : uint32
+    {
+        Http2FrameHeaderSize           = 9u,
+        Http2ConnectionPrefaceLength   = 24u,
+        Http2MaxFrameSize              = 16384u, //FK: SETTINGS_MAX_FRAME_SIZE default, we never announce or send more
+        Http2DefaultWindowSize         = 65535u,
+        Http2MaxWindowSize             = 0x7FFFFFFFu,
+        Http2MaxConcurrentStreams      = 100u, //FK: Clients assume 100 until our SETTINGS arrive, refused streams get retried on a new connection
+        Http2ReceiveBufferSize         = 2u * ( Http2FrameHeaderSize + Http2MaxFrameSize ),
+        Http2SendBufferSize            = 64u * 1024u,
+        Http2HeaderBlockBufferSize     = 16u * 1024u,
+        Http2HeaderScratchBufferSize   = 16u * 1024u,
+        Http2ArenaSize                 = 192u * 1024u,
+        Http2IdleTimeoutInMs           = 5000u,
+        Http2MaxConnectionLifetimeInMs = 30000u,
+        Http2DrainTimeoutInMs          = 5000u //FK: time the active streams get to finish after our GOAWAY
+    };
+
+    enum class http2_frame_type : uint8
+    {
+        data          = 0x0,
+        headers       = 0x1,
+        priority      = 0x2,
+        rst_stream    = 0x3,
+        settings      = 0x4,
+        push_promise  = 0x5,
+        ping          = 0x6,
+        goaway        = 0x7,
+        window_update = 0x8,
+        continuation  = 0x9
+    };
+
+    enum : uint8
+    {
+        Http2FlagEndStream  = 0x01,
+        Http2FlagAck        = 0x01,
+        Http2FlagEndHeaders = 0x04,
+        Http2FlagPadded     = 0x08,
+        Http2FlagPriority   = 0x20
+    };
+
+    enum class http2_setting : uint16
+    {
+        header_table_size      = 0x1,
+        enable_push            = 0x2,
+        max_concurrent_streams = 0x3,
+        initial_window_size    = 0x4,
+        max_frame_size         = 0x5,
+        max_header_list_size   = 0x6
+    };
+
+    enum class http2_error_code : uint32
+    {
+        no_error            = 0x0,
+        protocol_error      = 0x1,
+        internal_error      = 0x2,
+        flow_control_error  = 0x3,
+        settings_timeout    = 0x4,
+        stream_closed       = 0x5,
+        frame_size_error    = 0x6,
+        refused_stream      = 0x7,
+        cancel              = 0x8,
+        compression_error   = 0x9,
+        connect_error       = 0xa,
+        enhance_your_calm   = 0xb,
+        inadequate_security = 0xc,
+        http_1_1_required   = 0xd
+    };
+
+    enum class http2_wait_result
+    {
+        error,
+        timeout,
+        client_data,
+        pending_connection
+    };
+
+    const char http2ConnectionPreface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+    //FK: One block per connection, everything the connection needs (framing buffers, HPACK tables, streams) is carved out of it
+    struct http2_arena_memory
+    {
+        alignas( 16 ) uint8 memory[ Http2ArenaSize ];
+    };
+
+    struct http2_arena
+    {
+        uint8* pMemory;
+        size_t capacity;
+        size_t offset;
+    };
+
+    struct http2_frame_header
+    {
+        uint32           length;
+        http2_frame_type type;
+        uint8            flags;
+        uint32           streamId;
+    };
+
+    //FK: Read through the same k15_io file api as the HTTP/1.1 path
+    struct http2_file_body
+    {
+        http2_file_body( const string_view& filePath )
+            : file( filePath, file_access_mask( file_access::read ) )
+            , offsetInBytes( 0u )
+        {
+        }
+
+        file_handle_scope     file;
+        size_t                offsetInBytes;
+        dynamic_array< char > readBuffer;
+    };
+
+    struct http2_stream
+    {
+        uint32                    id; //FK: 0 marks a free slot
+        int64                     sendWindow;
+        bool                      hasPendingBody;
+        bool                      hasKnownBodySize;
+        uint64                    remainingBodySize;
+        html_chunk_producer       pBodyProducer;
+        void*                     pBodyProducerData;
+        http2_file_body*          pFileBody;
+        directory_listing_stream* pListingStream;
+        server_status_document*   pStatusDocument;
+    };
+
+    struct http2_request_headers
+    {
+        char path[ HtmlRequestPathLength ];
+        bool hasPath;
+        bool isGetRequest;
+        bool isHeadRequest;
+    };
+
+    struct http2_connection
+    {
+        html_server*        pServer;
+        html_client*        pClient;
+        http2_arena_memory* pArenaMemory;
+        http2_arena         arena;
+
+        hpack_decoder decoder;
+        hpack_encoder encoder;
+
+        http2_stream* pStreams;
+        uint32        highestStreamId;
+        uint32        nextScheduledStreamIndex;
+
+        uint8* pReceiveBuffer;
+        size_t receiveBufferSize;
+        uint8* pSendBuffer;
+        size_t sendBufferSize;
+
+        //FK: HEADERS + CONTINUATION fragments get collected here until END_HEADERS
+        uint8* pHeaderBlock;
+        size_t headerBlockSize;
+        uint32 headerBlockStreamId;
+        uint8* pHeaderScratch;
+
+        int64  connectionSendWindow;
+        uint32 peerInitialWindowSize;
+        bool   prefaceReceived;
+        bool   isClosing;
+    };
+
+    void* allocateFromHttp2Arena( http2_arena* pArena, size_t sizeInBytes )
+    {
+        const size_t alignedOffset = ( pArena->offset + 15u ) & ~( size_t )15u;
+        K15_ASSERT( alignedOffset + sizeInBytes <= pArena->capacity );
+
+        pArena->offset = alignedOffset + sizeInBytes;
+        return pArena->pMemory + alignedOffset;
+    }
+
+    template < typename T >
+    T* allocateFromHttp2Arena( http2_arena* pArena, size_t count )
+    {
+        return ( T* )allocateFromHttp2Arena( pArena, sizeof( T ) * count );
+    }
+
+    uint64 getHttp2TimestampInMs()
+    {
+#if defined( _WIN32 )
+        return ( uint64 )GetTickCount64();
+#else
+        timespec time;
+        clock_gettime( CLOCK_MONOTONIC, &time );
+        return ( uint64 )time.tv_sec * 1000u + ( uint64 )time.tv_nsec / 1000000u;
+#endif
+    }
+
+    bool isHttp2ConnectionPreface( const char* pData, size_t dataSizeInBytes )
+    {
+        return dataSizeInBytes >= Http2ConnectionPrefaceLength && memcmp( pData, http2ConnectionPreface, Http2ConnectionPrefaceLength ) == 0;
+    }
+
+    bool isHttp2UpgradeRequest( const char* pMessage )
+    {
+        const char* pUpgradeValue      = nullptr;
+        size_t      upgradeValueLength = 0u;
+        if ( !findHttpHeaderValue( pMessage, "upgrade", &pUpgradeValue, &upgradeValueLength ) )
+        {
+            return false;
+        }
+
+        const char* pSettingsValue      = nullptr;
+        size_t      settingsValueLength = 0u;
+        return upgradeValueLength == 3u && memcmp( pUpgradeValue, "h2c", 3u ) == 0 &&
+               findHttpHeaderValue( pMessage, "http2-settings", &pSettingsValue, &settingsValueLength );
+    }
+
+    uint32 readHttp2UInt32( const uint8* pData )
+    {
+        return ( ( uint32 )pData[ 0 ] << 24u ) | ( ( uint32 )pData[ 1 ] << 16u ) | ( ( uint32 )pData[ 2 ] << 8u ) | pData[ 3 ];
+    }
+
+    void writeHttp2UInt32( uint8* pTarget, uint32 value )
+    {
+        pTarget[ 0 ] = ( uint8 )( value >> 24u );
+        pTarget[ 1 ] = ( uint8 )( value >> 16u );
+        pTarget[ 2 ] = ( uint8 )( value >> 8u );
+        pTarget[ 3 ] = ( uint8 )value;
+    }
+
+    http2_frame_header readHttp2FrameHeader( const uint8* pData )
+    {
+        http2_frame_header header;
+        header.length   = ( ( uint32 )pData[ 0 ] << 16u ) | ( ( uint32 )pData[ 1 ] << 8u ) | pData[ 2 ];
+        header.type     = ( http2_frame_type )pData[ 3 ];
+        header.flags    = pData[ 4 ];
+        header.streamId = readHttp2UInt32( pData + 5u ) & 0x7FFFFFFFu;
+        return header;
+    }
+
+    void writeHttp2FrameHeader( uint8* pTarget, uint32 length, http2_frame_type type, uint8 flags, uint32 streamId )
+    {
+        pTarget[ 0 ] = ( uint8 )( length >> 16u );
+        pTarget[ 1 ] = ( uint8 )( length >> 8u );
+        pTarget[ 2 ] = ( uint8 )length;
+        pTarget[ 3 ] = ( uint8 )type;
+        pTarget[ 4 ] = flags;
+        writeHttp2UInt32( pTarget + 5u, streamId );
+    }
+
+    result< void > flushHttp2SendBuffer( http2_connection* pConnection )
+    {
+        if ( pConnection->sendBufferSize == 0u )
+        {
+            return error_id::success;
+        }
+
+        const result< void > sendResult = sendToClient( pConnection->pClient, ( const char* )pConnection->pSendBuffer, pConnection->sendBufferSize );
+        pConnection->sendBufferSize     = 0u;
+        return sendResult;
+    }
+
+    //FK: Frames are batched in the send buffer and go out with a single send() per loop iteration
+    result< uint8* > reserveHttp2Frame( http2_connection* pConnection, size_t maxPayloadSize )
+    {
+        K15_ASSERT( Http2FrameHeaderSize + maxPayloadSize <= Http2SendBufferSize );
+
+        if ( pConnection->sendBufferSize + Http2FrameHeaderSize + maxPayloadSize > Http2SendBufferSize )
+        {
+            const result< void > flushResult = flushHttp2SendBuffer( pConnection );
+            if ( flushResult.hasError() )
+            {
+                return flushResult.getError();
+            }
+        }
+
+        return pConnection->pSendBuffer + pConnection->sendBufferSize;
+    }
+
+    void commitHttp2Frame( http2_connection* pConnection, uint8* pFrame, uint32 payloadSize, http2_frame_type type, uint8 flags, uint32 streamId )
+    {
+        writeHttp2FrameHeader( pFrame, payloadSize, type, flags, streamId );
+        pConnection->sendBufferSize += Http2FrameHeaderSize + payloadSize;
+    }
+
+    result< void > queueHttp2Frame( http2_connection* pConnection, http2_frame_type type, uint8 flags, uint32 streamId, const uint8* pPayload, uint32 payloadSize )
+    {
+        const result< uint8* > reserveResult = reserveHttp2Frame( pConnection, payloadSize );
+        if ( reserveResult.hasError() )
+        {
+            return reserveResult.getError();
+        }
+
+        uint8* pFrame = reserveResult.getValue();
+        copyMemoryNonOverlapping( pFrame + Http2FrameHeaderSize, payloadSize, pPayload, payloadSize );
+        commitHttp2Frame( pConnection, pFrame, payloadSize, type, flags, streamId );
+        return error_id::success;
+    }
+
+    result< void > queueHttp2RstStream( http2_connection* pConnection, uint32 streamId, http2_error_code errorCode )
+    {
+        uint8 payload[ 4 ];
+        writeHttp2UInt32( payload, ( uint32 )errorCode );
+        return queueHttp2Frame( pConnection, http2_frame_type::rst_stream, 0u, streamId, payload, sizeof( payload ) );
+    }
+
+    result< void > queueHttp2WindowUpdate( http2_connection* pConnection, uint32 streamId, uint32 increment )
+    {
+        uint8 payload[ 4 ];
+        writeHttp2UInt32( payload, increment );
+        return queueHttp2Frame( pConnection, http2_frame_type::window_update, 0u, streamId, payload, sizeof( payload ) );
+    }
+
+    result< void > queueHttp2GoAway( http2_connection* pConnection, http2_error_code errorCode )
+    {
+        uint8 payload[ 8 ];
+        writeHttp2UInt32( payload, pConnection->highestStreamId );
+        writeHttp2UInt32( payload + 4u, ( uint32 )errorCode );
+        pConnection->isClosing = true;
+        return queueHttp2Frame( pConnection, http2_frame_type::goaway, 0u, 0u, payload, sizeof( payload ) );
+    }
+
+    result< void > queueHttp2ServerSettings( http2_connection* pConnection )
+    {
+        const uint32 settings[][ 2 ] = {
+            { ( uint32 )http2_setting::max_concurrent_streams, Http2MaxConcurrentStreams },
+            { ( uint32 )http2_setting::enable_push, 0u },
+            { ( uint32 )http2_setting::max_header_list_size, Http2HeaderScratchBufferSize } };
+
+        uint8 payload[ K15_ARRAY_SIZE( settings ) * 6u ];
+        for ( size_t settingIndex = 0u; settingIndex < K15_ARRAY_SIZE( settings ); ++settingIndex )
+        {
+            uint8* pSetting = payload + settingIndex * 6u;
+            pSetting[ 0 ]   = ( uint8 )( settings[ settingIndex ][ 0 ] >> 8u );
+            pSetting[ 1 ]   = ( uint8 )settings[ settingIndex ][ 0 ];
+            writeHttp2UInt32( pSetting + 2u, settings[ settingIndex ][ 1 ] );
+        }
+
+        return queueHttp2Frame( pConnection, http2_frame_type::settings, 0u, 0u, payload, sizeof( payload ) );
+    }
+
+    http2_connection* createHttp2Connection( html_server* pServer, html_client* pClient )
+    {
+        http2_arena_memory* pArenaMemory = newObject< http2_arena_memory >( pServer->pAllocator );
+        if ( pArenaMemory == nullptr )
+        {
+            return nullptr;
+        }
+
+        http2_arena arena;
+        arena.pMemory  = pArenaMemory->memory;
+        arena.capacity = Http2ArenaSize;
+        arena.offset   = 0u;
+
+        http2_connection* pConnection = allocateFromHttp2Arena< http2_connection >( &arena, 1u );
+        pConnection->pServer          = pServer;
+        pConnection->pClient          = pClient;
+        pConnection->pArenaMemory     = pArenaMemory;
+
+        pConnection->pReceiveBuffer    = allocateFromHttp2Arena< uint8 >( &arena, Http2ReceiveBufferSize );
+        pConnection->receiveBufferSize = 0u;
+        pConnection->pSendBuffer       = allocateFromHttp2Arena< uint8 >( &arena, Http2SendBufferSize );
+        pConnection->sendBufferSize    = 0u;
+
+        pConnection->pHeaderBlock        = allocateFromHttp2Arena< uint8 >( &arena, Http2HeaderBlockBufferSize );
+        pConnection->headerBlockSize     = 0u;
+        pConnection->headerBlockStreamId = 0u;
+        pConnection->pHeaderScratch      = allocateFromHttp2Arena< uint8 >( &arena, Http2HeaderScratchBufferSize );
+
+        char*                      pDecoderStorage = allocateFromHttp2Arena< char >( &arena, HpackDefaultDynamicTableSize );
+        hpack_dynamic_table_entry* pDecoderEntries = allocateFromHttp2Arena< hpack_dynamic_table_entry >( &arena, HpackMaxDynamicTableEntryCount );
+        char*                      pEncoderStorage = allocateFromHttp2Arena< char >( &arena, HpackDefaultDynamicTableSize );
+        hpack_dynamic_table_entry* pEncoderEntries = allocateFromHttp2Arena< hpack_dynamic_table_entry >( &arena, HpackMaxDynamicTableEntryCount );
+        initializeHpackDecoder( &pConnection->decoder, pDecoderStorage, pDecoderEntries, HpackDefaultDynamicTableSize );
+        initializeHpackEncoder( &pConnection->encoder, pEncoderStorage, pEncoderEntries, HpackDefaultDynamicTableSize );
+
+        pConnection->pStreams = allocateFromHttp2Arena< http2_stream >( &arena, Http2MaxConcurrentStreams );
+        for ( size_t streamIndex = 0u; streamIndex < Http2MaxConcurrentStreams; ++streamIndex )
+        {
+            pConnection->pStreams[ streamIndex ].id              = 0u;
+            pConnection->pStreams[ streamIndex ].hasPendingBody  = false;
+            pConnection->pStreams[ streamIndex ].pFileBody       = nullptr;
+            pConnection->pStreams[ streamIndex ].pListingStream  = nullptr;
+            pConnection->pStreams[ streamIndex ].pStatusDocument = nullptr;
+        }
+
+        pConnection->highestStreamId          = 0u;
+        pConnection->nextScheduledStreamIndex = 0u;
+        pConnection->connectionSendWindow     = Http2DefaultWindowSize;
+        pConnection->peerInitialWindowSize    = Http2DefaultWindowSize;
+        pConnection->prefaceReceived          = false;
+        pConnection->isClosing                = false;
+
+        pConnection->arena = arena;
+        return pConnection;
+    }
+
+    void closeHttp2Stream( http2_connection* pConnection, http2_stream* pStream )
+    {
+        if ( pStream->pFileBody != nullptr )
+        {
+            deleteObject( pStream->pFileBody, pConnection->pServer->pAllocator );
+            pStream->pFileBody = nullptr;
+        }
+
+        if ( pStream->pListingStream != nullptr )
+        {
+            closeDirectoryListingStream( pStream->pListingStream );
+            deleteObject( pStream->pListingStream, pConnection->pServer->pAllocator );
+            pStream->pListingStream = nullptr;
+        }
+
+        if ( pStream->pStatusDocument != nullptr )
+        {
+            deleteObject( pStream->pStatusDocument, pConnection->pServer->pAllocator );
+            pStream->pStatusDocument = nullptr;
+        }
+
+        pStream->id             = 0u;
+        pStream->hasPendingBody = false;
+    }
+
+    void destroyHttp2Connection( http2_connection* pConnection )
+    {
+        for ( size_t streamIndex = 0u; streamIndex < Http2MaxConcurrentStreams; ++streamIndex )
+        {
+            closeHttp2Stream( pConnection, pConnection->pStreams + streamIndex );
+        }
+
+        //FK: The connection itself lives in the arena, grab what we need before freeing it
+        memory_allocator*   pAllocator   = pConnection->pServer->pAllocator;
+        http2_arena_memory* pArenaMemory = pConnection->pArenaMemory;
+        deleteObject( pArenaMemory, pAllocator );
+    }
+
+    http2_stream* findHttp2Stream( http2_connection* pConnection, uint32 streamId )
+    {
+        for ( size_t streamIndex = 0u; streamIndex < Http2MaxConcurrentStreams; ++streamIndex )
+        {
+            if ( pConnection->pStreams[ streamIndex ].id == streamId )
+            {
+                return pConnection->pStreams + streamIndex;
+            }
+        }
+
+        return nullptr;
+    }
+
+    //FK: Streams that didn't finish in time, the client shouldn't mistake them for complete responses
+    void cancelActiveHttp2Streams( http2_connection* pConnection )
+    {
+        for ( size_t streamIndex = 0u; streamIndex < Http2MaxConcurrentStreams; ++streamIndex )
+        {
+            http2_stream* pStream = pConnection->pStreams + streamIndex;
+            if ( pStream->id != 0u )
+            {
+                queueHttp2RstStream( pConnection, pStream->id, http2_error_code::cancel );
+                closeHttp2Stream( pConnection, pStream );
+            }
+        }
+
+        flushHttp2SendBuffer( pConnection );
+    }
+
+    bool hasActiveHttp2Streams( const http2_connection* pConnection )
+    {
+        for ( size_t streamIndex = 0u; streamIndex < Http2MaxConcurrentStreams; ++streamIndex )
+        {
+            if ( pConnection->pStreams[ streamIndex ].id != 0u )
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    const char* getContentTypeForPath( const char* pPath )
+    {
+        const static struct
+        {
+            const char* pExtension;
+            const char* pContentType;
+        } contentTypes[] = {
+            { ".html", "text/html; charset=utf-8" },
+            { ".htm", "text/html; charset=utf-8" },
+            { ".css", "text/css" },
+            { ".js", "text/javascript" },
+            { ".json", "application/json" },
+            { ".png", "image/png" },
+            { ".jpg", "image/jpeg" },
+            { ".svg", "image/svg+xml" },
+            { ".ico", "image/x-icon" },
+            { ".txt", "text/plain; charset=utf-8" },
+            { ".log", "text/plain; charset=utf-8" } };
+
+        const char* pExtension = strrchr( pPath, '.' );
+        if ( pExtension != nullptr )
+        {
+            for ( size_t typeIndex = 0u; typeIndex < K15_ARRAY_SIZE( contentTypes ); ++typeIndex )
+            {
+                if ( compareAsciiStringNonCaseSensitive( pExtension, contentTypes[ typeIndex ].pExtension ) && strlen( pExtension ) == strlen( contentTypes[ typeIndex ].pExtension ) )
+                {
+                    return contentTypes[ typeIndex ].pContentType;
+                }
+            }
+        }
+
+        return "application/octet-stream";
+    }
+
+    //FK: Full 64 bit size, queried from the path since k15_io has no size query
+    bool getFileSizeInBytes( const char* pFilePath, uint64* pFileSizeInBytes )
+    {
+#if defined( _WIN32 )
+        WIN32_FILE_ATTRIBUTE_DATA attributeData;
+        if ( !GetFileAttributesExA( pFilePath, GetFileExInfoStandard, &attributeData ) )
+        {
+            return false;
+        }
+
+        *pFileSizeInBytes = ( ( uint64 )attributeData.nFileSizeHigh << 32u ) | attributeData.nFileSizeLow;
+        return true;
+#else
+        struct stat fileStat;
+        if ( stat( pFilePath, &fileStat ) != 0 )
+        {
+            return false;
+        }
+
+        *pFileSizeInBytes = ( uint64 )fileStat.st_size;
+        return true;
+#endif
+    }
+
+    result< size_t > produceHttp2FileChunk( void* pUserData, char* pBuffer, size_t bufferSizeInBytes )
+    {
+        http2_file_body*       pFileBody   = ( http2_file_body* )pUserData;
+        const size_t           bytesToRead = bufferSizeInBytes < pFileBody->readBuffer.getCapacity() ? bufferSizeInBytes : pFileBody->readBuffer.getCapacity();
+        const result< size_t > readResult  = readFromFile( pFileBody->file.getHandle(), pFileBody->offsetInBytes, &pFileBody->readBuffer, bytesToRead );
+        if ( readResult.hasError() )
+        {
+            return readResult.getError();
+        }
+
+        const size_t bytesRead = readResult.getValue();
+        copyMemoryNonOverlapping( pBuffer, bufferSizeInBytes, pFileBody->readBuffer.getStart(), bytesRead );
+        pFileBody->offsetInBytes += bytesRead;
+        return bytesRead;
+    }
+
+    result< void > queueHttp2ResponseHeaders( http2_connection* pConnection, uint32 streamId, const char* pStatus, const char* pContentType, const uint64* pContentLength, bool endStream )
+    {
+        //FK: Our header blocks are a couple of dozen bytes, 512 bytes is plenty and avoids CONTINUATION frames
+        const size_t           maxHeaderBlockSize = 512u;
+        const result< uint8* > reserveResult      = reserveHttp2Frame( pConnection, maxHeaderBlockSize );
+        if ( reserveResult.hasError() )
+        {
+            return reserveResult.getError();
+        }
+
+        uint8*       pFrame = reserveResult.getValue();
+        hpack_buffer headerBlock;
+        headerBlock.pData    = pFrame + Http2FrameHeaderSize;
+        headerBlock.size     = 0u;
+        headerBlock.capacity = maxHeaderBlockSize;
+
+        hpack_encoder* pEncoder = &pConnection->encoder;
+        bool           encoded  = encodeHpackHeaderField( pEncoder, &headerBlock, ":status", pStatus, hpack_indexing::incremental );
+        if ( encoded && pContentType != nullptr )
+        {
+            encoded = encodeHpackHeaderField( pEncoder, &headerBlock, "content-type", pContentType, hpack_indexing::incremental );
+        }
+
+        if ( encoded && pContentLength != nullptr )
+        {
+            //FK: Lengths rarely repeat, indexing them would only push the useful entries out of the table
+            char contentLength[ 24 ];
+            snprintf( contentLength, sizeof( contentLength ), "%llu", ( unsigned long long )*pContentLength );
+            encoded = encodeHpackHeaderField( pEncoder, &headerBlock, "content-length", contentLength, hpack_indexing::without );
+        }
+
+        if ( !encoded )
+        {
+            return error_id::out_of_memory;
+        }
+
+        const uint8 flags = Http2FlagEndHeaders | ( endStream ? Http2FlagEndStream : 0u );
+        commitHttp2Frame( pConnection, pFrame, ( uint32 )headerBlock.size, http2_frame_type::headers, flags, streamId );
+        return error_id::success;
+    }
+
+    //FK: Starts the response for a request whose headers are complete. Body data is sent later by writeHttp2StreamData
+    result< void > startHttp2Response( http2_connection* pConnection, http2_stream* pStream, const http2_request_headers& request )
+    {
+        html_server* pServer  = pConnection->pServer;
+        const uint32 streamId = pStream->id;
+
+        if ( !request.isGetRequest && !request.isHeadRequest )
+        {
+            closeHttp2Stream( pConnection, pStream );
+            return queueHttp2ResponseHeaders( pConnection, streamId, "405", nullptr, nullptr, true );
+        }
+
+        path                      servePath( pServer->pAllocator );
+        const html_request_target target = request.hasPath ? resolveRequestTarget( pServer, request.path, &servePath ) : html_request_target::not_found;
+
+        char servePathBuffer[ DirectoryPathLength ];
+        if ( target == html_request_target::not_found || !copyPathToBuffer( servePathBuffer, DirectoryPathLength, servePath ) )
+        {
+            closeHttp2Stream( pConnection, pStream );
+            return queueHttp2ResponseHeaders( pConnection, streamId, "404", nullptr, nullptr, true );
+        }
+
+        if ( target == html_request_target::server_status )
+        {
+            server_status_document* pDocument = newObject< server_status_document >( pServer->pAllocator );
+            if ( pDocument == nullptr || renderServerStatusDocument( pDocument, pServer->pStatusBoard ).hasError() )
+            {
+                if ( pDocument != nullptr )
+                {
+                    deleteObject( pDocument, pServer->pAllocator );
+                }
+
+                closeHttp2Stream( pConnection, pStream );
+                return queueHttp2ResponseHeaders( pConnection, streamId, "500", nullptr, nullptr, true );
+            }
+
+            pStream->pStatusDocument   = pDocument;
+            pStream->pBodyProducer     = produceServerStatusChunk;
+            pStream->pBodyProducerData = pDocument;
+            pStream->hasKnownBodySize  = true;
+            pStream->remainingBodySize = pDocument->size;
+        }
+        else if ( target == html_request_target::directory_listing )
+        {
+            directory_listing_stream* pListingStream = newObject< directory_listing_stream >( pServer->pAllocator );
+            if ( pListingStream == nullptr || openDirectoryListingStream( pListingStream, pServer->pDirectoryListingCache, servePathBuffer, request.path ).hasError() )
+            {
+                if ( pListingStream != nullptr )
+                {
+                    deleteObject( pListingStream, pServer->pAllocator );
+                }
+
+                closeHttp2Stream( pConnection, pStream );
+                return queueHttp2ResponseHeaders( pConnection, streamId, "404", nullptr, nullptr, true );
+            }
+
+            pStream->pListingStream    = pListingStream;
+            pStream->pBodyProducer     = produceDirectoryListingChunk;
+            pStream->pBodyProducerData = pListingStream;
+            pStream->hasKnownBodySize  = false;
+        }
+        else
+        {
+            http2_file_body* pFileBody = newObject< http2_file_body >( pServer->pAllocator, servePath );
+            pStream->pFileBody         = pFileBody;
+            if ( pFileBody == nullptr || pFileBody->file.hasError() || !pFileBody->readBuffer.create( pServer->pAllocator, Http2MaxFrameSize ) )
+            {
+                closeHttp2Stream( pConnection, pStream );
+                return queueHttp2ResponseHeaders( pConnection, streamId, "404", nullptr, nullptr, true );
+            }
+
+            uint64 fileSizeInBytes     = 0u;
+            pStream->pBodyProducer     = produceHttp2FileChunk;
+            pStream->pBodyProducerData = pFileBody;
+            pStream->hasKnownBodySize  = getFileSizeInBytes( servePathBuffer, &fileSizeInBytes );
+            pStream->remainingBodySize = fileSizeInBytes;
+        }
+
+        const char* pContentType = getContentTypeForPath( servePathBuffer );
+        if ( target == html_request_target::directory_listing )
+        {
+            pContentType = "text/html; charset=utf-8";
+        }
+        else if ( target == html_request_target::server_status )
+        {
+            pContentType = "application/json";
+        }
+
+        const uint64* pContentLength = pStream->hasKnownBodySize ? &pStream->remainingBodySize : nullptr;
+        if ( request.isHeadRequest )
+        {
+            const result< void > headersResult = queueHttp2ResponseHeaders( pConnection, streamId, "200", pContentType, pContentLength, true );
+            closeHttp2Stream( pConnection, pStream );
+            return headersResult;
+        }
+
+        pStream->hasPendingBody = true;
+        return queueHttp2ResponseHeaders( pConnection, streamId, "200", pContentType, pContentLength, false );
+    }
+
+    void collectHttp2RequestHeader( void* pUserData, const hpack_header_field& field )
+    {
+        http2_request_headers* pRequest = ( http2_request_headers* )pUserData;
+        if ( compareHpackString( field.pName, field.nameLength, ":method", 7u ) )
+        {
+            pRequest->isGetRequest  = compareHpackString( field.pValue, field.valueLength, "GET", 3u );
+            pRequest->isHeadRequest = compareHpackString( field.pValue, field.valueLength, "HEAD", 4u );
+        }
+        else if ( compareHpackString( field.pName, field.nameLength, ":path", 5u ) && field.valueLength < HtmlRequestPathLength )
+        {
+            copyMemoryNonOverlapping( pRequest->path, HtmlRequestPathLength, field.pValue, field.valueLength );
+            pRequest->path[ field.valueLength ] = 0;
+            pRequest->hasPath                   = decodeUrlPath( pRequest->path );
+        }
+    }
+
+    http2_error_code processHttp2HeaderBlock( http2_connection* pConnection )
+    {
+        const uint32 streamId = pConnection->headerBlockStreamId;
+        pConnection->headerBlockStreamId = 0u;
+
+        http2_request_headers request;
+        request.hasPath       = false;
+        request.isGetRequest  = false;
+        request.isHeadRequest = false;
+
+        hpack_buffer scratch;
+        scratch.pData    = pConnection->pHeaderScratch;
+        scratch.size     = 0u;
+        scratch.capacity = Http2HeaderScratchBufferSize;
+
+        //FK: The block has to be decoded even if we're going to refuse the stream, otherwise the HPACK state gets out of sync
+        const result< void > decodeResult = decodeHpackHeaderBlock( &pConnection->decoder, pConnection->pHeaderBlock, pConnection->headerBlockSize, &scratch, collectHttp2RequestHeader, &request );
+        pConnection->headerBlockSize      = 0u;
+        if ( decodeResult.hasError() )
+        {
+            return decodeResult.getError() == error_id::out_of_memory ? http2_error_code::enhance_your_calm : http2_error_code::compression_error;
+        }
+
+        if ( streamId <= pConnection->highestStreamId )
+        {
+            //FK: Trailers, nothing in there we care about. Our response may already be out and the slot freed (eg. body +
+            //    trailers after an immediate 405) - the stream is only half closed then, so just like DATA they're ignored
+            return http2_error_code::no_error;
+        }
+
+        pConnection->highestStreamId = streamId;
+
+        http2_stream* pStream = findHttp2Stream( pConnection, 0u );
+        if ( pStream == nullptr || pConnection->isClosing )
+        {
+            queueHttp2RstStream( pConnection, streamId, http2_error_code::refused_stream );
+            return http2_error_code::no_error;
+        }
+
+        pStream->id             = streamId;
+        pStream->sendWindow     = pConnection->peerInitialWindowSize;
+        pStream->hasPendingBody = false;
+
+        const result< void > responseResult = startHttp2Response( pConnection, pStream, request );
+        return responseResult.isOk() ? http2_error_code::no_error : http2_error_code::internal_error;
+    }
+
+    http2_error_code appendHttp2HeaderBlockFragment( http2_connection* pConnection, const uint8* pFragment, size_t fragmentSize )
+    {
+        if ( pConnection->headerBlockSize + fragmentSize > Http2HeaderBlockBufferSize )
+        {
+            return http2_error_code::enhance_your_calm;
+        }
+
+        copyMemoryNonOverlapping( pConnection->pHeaderBlock + pConnection->headerBlockSize, Http2HeaderBlockBufferSize - pConnection->headerBlockSize, pFragment, fragmentSize );
+        pConnection->headerBlockSize += fragmentSize;
+        return http2_error_code::no_error;
+    }
+
+    //FK: Strips padding (and the priority block of HEADERS frames), returns false if the frame is malformed
+    bool getHttp2FramePayload( const http2_frame_header& header, const uint8* pPayload, size_t priorityBlockSize, const uint8** ppData, size_t* pDataSize )
+    {
+        size_t paddingSize = 0u;
+        size_t dataOffset  = 0u;
+        if ( header.flags & Http2FlagPadded )
+        {
+            if ( header.length < 1u )
+            {
+                return false;
+            }
+
+            paddingSize = pPayload[ 0 ];
+            dataOffset  = 1u;
+        }
+
+        dataOffset += priorityBlockSize;
+        if ( dataOffset + paddingSize > header.length )
+        {
+            return false;
+        }
+
+        *ppData    = pPayload + dataOffset;
+        *pDataSize = header.length - dataOffset - paddingSize;
+        return true;
+    }
+
+    http2_error_code applyHttp2Settings( http2_connection* pConnection, const uint8* pPayload, size_t payloadSize )
+    {
+        if ( payloadSize % 6u != 0u )
+        {
+            return http2_error_code::frame_size_error;
+        }
+
+        for ( size_t settingOffset = 0u; settingOffset < payloadSize; settingOffset += 6u )
+        {
+            const uint16 settingId = ( uint16 )( ( pPayload[ settingOffset ] << 8u ) | pPayload[ settingOffset + 1u ] );
+            const uint32 value     = readHttp2UInt32( pPayload + settingOffset + 2u );
+
+            switch ( ( http2_setting )settingId )
+            {
+            case http2_setting::header_table_size:
+                {
+                    setHpackEncoderMaxSize( &pConnection->encoder, value );
+                    break;
+                }
+
+            case http2_setting::enable_push:
+                {
+                    if ( value > 1u )
+                    {
+                        return http2_error_code::protocol_error;
+                    }
+                    break;
+                }
+
+            case http2_setting::initial_window_size:
+                {
+                    if ( value > Http2MaxWindowSize )
+                    {
+                        return http2_error_code::flow_control_error;
+                    }
+
+                    //FK: RFC 7540 6.9.2 - the change applies to the window of every open stream
+                    const int64 delta = ( int64 )value - ( int64 )pConnection->peerInitialWindowSize;
+                    for ( size_t streamIndex = 0u; streamIndex < Http2MaxConcurrentStreams; ++streamIndex )
+                    {
+                        http2_stream* pStream = pConnection->pStreams + streamIndex;
+                        if ( pStream->id != 0u )
+                        {
+                            pStream->sendWindow += delta;
+                        }
+                    }
+
+                    pConnection->peerInitialWindowSize = value;
+                    break;
+                }
+
+            case http2_setting::max_frame_size:
+                {
+                    //FK: We stick to 16KiB frames either way, but the value still has to be valid
+                    if ( value < Http2MaxFrameSize || value > 0xFFFFFFu )
+                    {
+                        return http2_error_code::protocol_error;
+                    }
+                    break;
+                }
+
+            default:
+                break;
+            }
+        }
+
+        return http2_error_code::no_error;
+    }
+
+    http2_error_code handleHttp2SettingsFrame( http2_connection* pConnection, const http2_frame_header& header, const uint8* pPayload )
+    {
+        if ( header.streamId != 0u )
+        {
+            return http2_error_code::protocol_error;
+        }
+
+        if ( header.flags & Http2FlagAck )
+        {
+            return header.length == 0u ? http2_error_code::no_error : http2_error_code::frame_size_error;
+        }
+
+        const http2_error_code settingsResult = applyHttp2Settings( pConnection, pPayload, header.length );
+        if ( settingsResult != http2_error_code::no_error )
+        {
+            return settingsResult;
+        }
+
+        return queueHttp2Frame( pConnection, http2_frame_type::settings, Http2FlagAck, 0u, nullptr, 0u ).isOk() ? http2_error_code::no_error : http2_error_code::internal_error;
+    }
+
+    http2_error_code handleHttp2Frame( http2_connection* pConnection, const http2_frame_header& header, const uint8* pPayload )
+    {
+        //FK: A header block has to be continued by CONTINUATION frames of the same stream without anything in between
+        if ( pConnection->headerBlockStreamId != 0u && ( header.type != http2_frame_type::continuation || header.streamId != pConnection->headerBlockStreamId ) )
+        {
+            return http2_error_code::protocol_error;
+        }
+
+        switch ( header.type )
+        {
+        case http2_frame_type::data:
+            {
+                if ( header.streamId == 0u || header.streamId > pConnection->highestStreamId )
+                {
+                    return http2_error_code::protocol_error;
+                }
+
+                //FK: We don't take request bodies, just hand the flow control credit straight back.
+                //    The stream window needs it as well, otherwise a body bigger than the initial window stalls the upload.
+                //    That's also true if our response is already out - the stream stays open on the client's side until
+                //    its body is complete (RST_STREAM(NO_ERROR) would be allowed too, but clients report that as a failure)
+                if ( header.length > 0u )
+                {
+                    queueHttp2WindowUpdate( pConnection, 0u, header.length );
+                    if ( !( header.flags & Http2FlagEndStream ) )
+                    {
+                        queueHttp2WindowUpdate( pConnection, header.streamId, header.length );
+                    }
+                }
+
+                return http2_error_code::no_error;
+            }
+
+        case http2_frame_type::headers:
+            {
+                if ( header.streamId == 0u || ( header.streamId & 1u ) == 0u )
+                {
+                    return http2_error_code::protocol_error;
+                }
+
+                const uint8* pFragment    = nullptr;
+                size_t       fragmentSize = 0u;
+                if ( !getHttp2FramePayload( header, pPayload, ( header.flags & Http2FlagPriority ) ? 5u : 0u, &pFragment, &fragmentSize ) )
+                {
+                    return http2_error_code::protocol_error;
+                }
+
+                const http2_error_code appendResult = appendHttp2HeaderBlockFragment( pConnection, pFragment, fragmentSize );
+                if ( appendResult != http2_error_code::no_error )
+                {
+                    return appendResult;
+                }
+
+                pConnection->headerBlockStreamId = header.streamId;
+                return ( header.flags & Http2FlagEndHeaders ) ? processHttp2HeaderBlock( pConnection ) : http2_error_code::no_error;
+            }
+
+        case http2_frame_type::continuation:
+            {
+                if ( pConnection->headerBlockStreamId == 0u )
+                {
+                    return http2_error_code::protocol_error;
+                }
+
+                const http2_error_code appendResult = appendHttp2HeaderBlockFragment( pConnection, pPayload, header.length );
+                if ( appendResult != http2_error_code::no_error )
+                {
+                    return appendResult;
+                }
+
+                return ( header.flags & Http2FlagEndHeaders ) ? processHttp2HeaderBlock( pConnection ) : http2_error_code::no_error;
+            }
+
+        case http2_frame_type::priority:
+            {
+                return header.length == 5u ? http2_error_code::no_error : http2_error_code::frame_size_error;
+            }
+
+        case http2_frame_type::rst_stream:
+            {
+                if ( header.streamId == 0u || header.length != 4u )
+                {
+                    return header.streamId == 0u ? http2_error_code::protocol_error : http2_error_code::frame_size_error;
+                }
+
+                http2_stream* pStream = findHttp2Stream( pConnection, header.streamId );
+                if ( pStream != nullptr )
+                {
+                    closeHttp2Stream( pConnection, pStream );
+                }
+
+                return http2_error_code::no_error;
+            }
+
+        case http2_frame_type::settings:
+            {
+                return handleHttp2SettingsFrame( pConnection, header, pPayload );
+            }
+
+        case http2_frame_type::push_promise:
+            {
+                //FK: Clients must not push
+                return http2_error_code::protocol_error;
+            }
+
+        case http2_frame_type::ping:
+            {
+                if ( header.streamId != 0u || header.length != 8u )
+                {
+                    return header.streamId != 0u ? http2_error_code::protocol_error : http2_error_code::frame_size_error;
+                }
+
+                if ( ( header.flags & Http2FlagAck ) == 0u )
+                {
+                    queueHttp2Frame( pConnection, http2_frame_type::ping, Http2FlagAck, 0u, pPayload, 8u );
+                }
+
+                return http2_error_code::no_error;
+            }
+
+        case http2_frame_type::goaway:
+            {
+                //FK: Finish what's in flight, then close
+                pConnection->isClosing = true;
+                return http2_error_code::no_error;
+            }
+
+        case http2_frame_type::window_update:
+            {
+                if ( header.length != 4u )
+                {
+                    return http2_error_code::frame_size_error;
+                }
+
+                const uint32 increment = readHttp2UInt32( pPayload ) & 0x7FFFFFFFu;
+                if ( header.streamId == 0u )
+                {
+                    pConnection->connectionSendWindow += increment;
+                    if ( increment == 0u || pConnection->connectionSendWindow > Http2MaxWindowSize )
+                    {
+                        return increment == 0u ? http2_error_code::protocol_error : http2_error_code::flow_control_error;
+                    }
+
+                    return http2_error_code::no_error;
+                }
+
+                http2_stream* pStream = findHttp2Stream( pConnection, header.streamId );
+                if ( pStream != nullptr )
+                {
+                    pStream->sendWindow += increment;
+                    if ( increment == 0u || pStream->sendWindow > Http2MaxWindowSize )
+                    {
+                        const http2_error_code streamError = increment == 0u ? http2_error_code::protocol_error : http2_error_code::flow_control_error;
+                        closeHttp2Stream( pConnection, pStream );
+                        queueHttp2RstStream( pConnection, header.streamId, streamError );
+                    }
+                }
+
+                return http2_error_code::no_error;
+            }
+
+        default:
+            //FK: Unknown frame types must be ignored
+            return http2_error_code::no_error;
+        }
+    }
+
+    http2_error_code processHttp2ReceiveBuffer( http2_connection* pConnection )
+    {
+        size_t readOffset = 0u;
+
+        if ( !pConnection->prefaceReceived )
+        {
+            if ( pConnection->receiveBufferSize < Http2ConnectionPrefaceLength )
+            {
+                return http2_error_code::no_error;
+            }
+
+            if ( !isHttp2ConnectionPreface( ( const char* )pConnection->pReceiveBuffer, pConnection->receiveBufferSize ) )
+            {
+                return http2_error_code::protocol_error;
+            }
+
+            pConnection->prefaceReceived = true;
+            readOffset                   = Http2ConnectionPrefaceLength;
+        }
+
+        http2_error_code errorCode = http2_error_code::no_error;
+        while ( pConnection->receiveBufferSize - readOffset >= Http2FrameHeaderSize )
+        {
+            const http2_frame_header header = readHttp2FrameHeader( pConnection->pReceiveBuffer + readOffset );
+            if ( header.length > Http2MaxFrameSize )
+            {
+                errorCode = http2_error_code::frame_size_error;
+                break;
+            }
+
+            if ( pConnection->receiveBufferSize - readOffset - Http2FrameHeaderSize < header.length )
+            {
+                break;
+            }
+
+            errorCode = handleHttp2Frame( pConnection, header, pConnection->pReceiveBuffer + readOffset + Http2FrameHeaderSize );
+            readOffset += Http2FrameHeaderSize + header.length;
+
+            if ( errorCode != http2_error_code::no_error )
+            {
+                break;
+            }
+        }
+
+        //FK: Keep the partial frame for the next recv()
+        const size_t remainingBytes = pConnection->receiveBufferSize - readOffset;
+        memmove( pConnection->pReceiveBuffer, pConnection->pReceiveBuffer + readOffset, remainingBytes );
+        pConnection->receiveBufferSize = remainingBytes;
+
+        return errorCode;
+    }
+
+    bool canWriteHttp2StreamData( const http2_connection* pConnection, const http2_stream* pStream )
+    {
+        return pStream->id != 0u && pStream->hasPendingBody && pStream->sendWindow > 0 && pConnection->connectionSendWindow > 0;
+    }
+
+    bool hasWritableHttp2StreamData( const http2_connection* pConnection )
+    {
+        for ( size_t streamIndex = 0u; streamIndex < Http2MaxConcurrentStreams; ++streamIndex )
+        {
+            if ( canWriteHttp2StreamData( pConnection, pConnection->pStreams + streamIndex ) )
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    //FK: Round robin over the streams, one DATA frame per stream and call so no stream can starve the others
+    result< void > writeHttp2StreamData( http2_connection* pConnection )
+    {
+        for ( size_t streamOffset = 0u; streamOffset < Http2MaxConcurrentStreams; ++streamOffset )
+        {
+            const size_t  streamIndex = ( pConnection->nextScheduledStreamIndex + streamOffset ) % Http2MaxConcurrentStreams;
+            http2_stream* pStream     = pConnection->pStreams + streamIndex;
+            if ( !canWriteHttp2StreamData( pConnection, pStream ) )
+            {
+                continue;
+            }
+
+            int64 frameSize = Http2MaxFrameSize;
+            frameSize       = pStream->sendWindow < frameSize ? pStream->sendWindow : frameSize;
+            frameSize       = pConnection->connectionSendWindow < frameSize ? pConnection->connectionSendWindow : frameSize;
+            if ( pStream->hasKnownBodySize && ( int64 )pStream->remainingBodySize < frameSize )
+            {
+                frameSize = ( int64 )pStream->remainingBodySize;
+            }
+
+            const result< uint8* > reserveResult = reserveHttp2Frame( pConnection, ( size_t )frameSize );
+            if ( reserveResult.hasError() )
+            {
+                return reserveResult.getError();
+            }
+
+            uint8*                 pFrame        = reserveResult.getValue();
+            const result< size_t > produceResult = frameSize > 0 ? pStream->pBodyProducer( pStream->pBodyProducerData, ( char* )pFrame + Http2FrameHeaderSize, ( size_t )frameSize ) : result< size_t >( ( size_t )0u );
+            if ( produceResult.hasError() )
+            {
+                queueHttp2RstStream( pConnection, pStream->id, http2_error_code::internal_error );
+                closeHttp2Stream( pConnection, pStream );
+                continue;
+            }
+
+            const size_t bytesProduced = produceResult.getValue();
+            if ( pStream->hasKnownBodySize )
+            {
+                pStream->remainingBodySize -= bytesProduced < pStream->remainingBodySize ? bytesProduced : pStream->remainingBodySize;
+            }
+
+            const bool endStream = bytesProduced == 0u || ( pStream->hasKnownBodySize && pStream->remainingBodySize == 0u );
+            commitHttp2Frame( pConnection, pFrame, ( uint32 )bytesProduced, http2_frame_type::data, endStream ? Http2FlagEndStream : 0u, pStream->id );
+
+            pStream->sendWindow -= bytesProduced;
+            pConnection->connectionSendWindow -= bytesProduced;
+
+            if ( endStream )
+            {
+                closeHttp2Stream( pConnection, pStream );
+            }
+        }
+
+        pConnection->nextScheduledStreamIndex = ( pConnection->nextScheduledStreamIndex + 1u ) % Http2MaxConcurrentStreams;
+        return error_id::success;
+    }
+
+    result< void > receiveHttp2Data( http2_connection* pConnection )
+    {
+        const size_t freeBytes = Http2ReceiveBufferSize - pConnection->receiveBufferSize;
+        const int    bytesRead = receiveFromSocket( pConnection->pClient->socket, ( char* )pConnection->pReceiveBuffer + pConnection->receiveBufferSize, freeBytes );
+        if ( bytesRead == socketError )
+        {
+            return isTransientSocketError( getLastSocketError() ) ? error_id::success : error_id::socket_error;
+        }
+
+        if ( bytesRead == 0 )
+        {
+            //FK: Peer closed the connection
+            return error_id::not_found;
+        }
+
+        pConnection->receiveBufferSize += ( size_t )bytesRead;
+        return error_id::success;
+    }
+
+    //FK: Also watches the listen sockets if requested, the server is single threaded so a connection that's waiting to be
+    //    accepted is our cue to wrap this one up
+    http2_wait_result waitForHttp2Event( const http2_connection* pConnection, uint32 timeoutInMs, bool watchListenSockets )
+    {
+        const html_server* pServer      = pConnection->pServer;
+        const socketId     clientSocket = pConnection->pClient->socket;
+
+        fd_set readSockets;
+        FD_ZERO( &readSockets );
+        FD_SET( clientSocket, &readSockets );
+
+        int descriptorCount = getSelectDescriptorCount( clientSocket, clientSocket );
+        if ( watchListenSockets )
+        {
+            if ( pServer->ipv4Socket != invalidSocket )
+            {
+                FD_SET( pServer->ipv4Socket, &readSockets );
+            }
+
+            if ( pServer->ipv6Socket != invalidSocket )
+            {
+                FD_SET( pServer->ipv6Socket, &readSockets );
+            }
+
+            const int listenDescriptorCount = getSelectDescriptorCount( pServer->ipv4Socket, pServer->ipv6Socket );
+            descriptorCount                 = listenDescriptorCount > descriptorCount ? listenDescriptorCount : descriptorCount;
+        }
+
+        timeval timeout;
+        timeout.tv_sec  = ( long )( timeoutInMs / 1000u );
+        timeout.tv_usec = ( long )( ( timeoutInMs % 1000u ) * 1000u );
+
+        const int selectResult = select( descriptorCount, &readSockets, nullptr, nullptr, &timeout );
+        if ( selectResult == socketError )
+        {
+            return isTransientSocketError( getLastSocketError() ) ? http2_wait_result::timeout : http2_wait_result::error;
+        }
+
+        if ( selectResult == 0 )
+        {
+            return http2_wait_result::timeout;
+        }
+
+        //FK: A waiting connection wins, the client data is still there after we've queued the GOAWAY
+        const bool hasPendingConnection = ( pServer->ipv4Socket != invalidSocket && FD_ISSET( pServer->ipv4Socket, &readSockets ) ) ||
+                                          ( pServer->ipv6Socket != invalidSocket && FD_ISSET( pServer->ipv6Socket, &readSockets ) );
+        return watchListenSockets && hasPendingConnection ? http2_wait_result::pending_connection : http2_wait_result::client_data;
+    }
+
+    //FK: HTTP2-Settings carries a base64url encoded SETTINGS payload (RFC 7540 3.2.1)
+    bool decodeHttp2UpgradeSettings( const char* pValue, size_t valueLength, uint8* pTarget, size_t targetCapacity, size_t* pTargetSize )
+    {
+        uint32 bits     = 0u;
+        uint32 bitCount = 0u;
+        size_t size     = 0u;
+
+        for ( size_t charIndex = 0u; charIndex < valueLength; ++charIndex )
+        {
+            const char character = pValue[ charIndex ];
+            uint32     sextet    = 0u;
+            if ( character >= 'A' && character <= 'Z' ) sextet = character - 'A';
+            else if ( character >= 'a' && character <= 'z' ) sextet = character - 'a' + 26;
+            else if ( character >= '0' && character <= '9' ) sextet = character - '0' + 52;
+            else if ( character == '-' ) sextet = 62;
+            else if ( character == '_' ) sextet = 63;
+            else if ( character == '=' ) break;
+            else return false;
+
+            bits = ( bits << 6u ) | sextet;
+            bitCount += 6u;
+            if ( bitCount >= 8u )
+            {
+                bitCount -= 8u;
+                if ( size == targetCapacity )
+                {
+                    return false;
+                }
+
+                pTarget[ size++ ] = ( uint8 )( bits >> bitCount );
+            }
+        }
+
+        *pTargetSize = size;
+        return true;
+    }
+
+    //FK: Serves a client that either sent the HTTP/2 preface (pReceivedData holds everything read so far) or asked for an
+    //    h2c upgrade (pReceivedData holds the HTTP/1.1 request, pUpgradeRequest gets answered on stream 1).
+    //    Returns once the connection is done.
+    void serveHttp2Client( html_server* pServer, html_client* pClient, const char* pReceivedData, size_t receivedDataSizeInBytes, const html_request* pUpgradeRequest )
+    {
+        http2_connection* pConnection = createHttp2Connection( pServer, pClient );
+        if ( pConnection == nullptr )
+        {
+            return;
+        }
+
+        //FK: receiveClientData reads everything that's available, which can be more than the receive buffer holds
+        //    (eg. request bodies sent right after the headers). Fed to the receive buffer bit by bit before we recv() again
+        const char* pPendingData    = pUpgradeRequest == nullptr ? pReceivedData : nullptr;
+        size_t      pendingDataSize = pUpgradeRequest == nullptr ? receivedDataSizeInBytes : 0u;
+
+        http2_error_code errorCode = http2_error_code::no_error;
+        if ( pUpgradeRequest != nullptr )
+        {
+            const char switchingProtocols[] = "HTTP/1.1 101 Switching Protocols\r\n"
+                                              "Connection: Upgrade\r\n"
+                                              "Upgrade: h2c\r\n\r\n";
+            if ( sendToClient( pClient, switchingProtocols, sizeof( switchingProtocols ) - 1u ).hasError() )
+            {
+                destroyHttp2Connection( pConnection );
+                return;
+            }
+        }
+
+        //FK: Responses of many streams go out in small batches, Nagle would hold them back until the client ACKs the previous batch
+        setSocketOption( pClient->socket, IPPROTO_TCP, TCP_NODELAY, 1 );
+
+        //FK: A client that stops reading mustn't be able to stall the server in send()
+        setSocketSendTimeout( pClient->socket, Http2DrainTimeoutInMs );
+
+        //FK: The server preface has to be the first frame we send
+        queueHttp2ServerSettings( pConnection );
+
+        if ( pUpgradeRequest != nullptr )
+        {
+            //FK: The 101 response acknowledges these implicitly, no SETTINGS ACK for them
+            const char* pSettingsValue      = nullptr;
+            size_t      settingsValueLength = 0u;
+            uint8       settings[ 256 ];
+            size_t      settingsSize = 0u;
+            if ( !findHttpHeaderValue( pReceivedData, "http2-settings", &pSettingsValue, &settingsValueLength ) ||
+                 !decodeHttp2UpgradeSettings( pSettingsValue, settingsValueLength, settings, sizeof( settings ), &settingsSize ) )
+            {
+                errorCode = http2_error_code::protocol_error;
+            }
+            else
+            {
+                errorCode = applyHttp2Settings( pConnection, settings, settingsSize );
+            }
+
+            http2_request_headers request;
+            copyMemoryNonOverlapping( request.path, HtmlRequestPathLength, pUpgradeRequest->path, HtmlRequestPathLength );
+            request.hasPath       = true;
+            request.isGetRequest  = true;
+            request.isHeadRequest = false;
+
+            //FK: The upgraded request implicitly becomes stream 1
+            http2_stream* pStream        = pConnection->pStreams;
+            pStream->id                  = 1u;
+            pStream->sendWindow          = pConnection->peerInitialWindowSize;
+            pConnection->highestStreamId = 1u;
+
+            if ( errorCode == http2_error_code::no_error && startHttp2Response( pConnection, pStream, request ).hasError() )
+            {
+                errorCode = http2_error_code::internal_error;
+            }
+        }
+
+        //FK: Single threaded server, so every connection has a bounded lifetime: we send GOAWAY as soon as another client
+        //    is waiting to be accepted or after Http2MaxConnectionLifetimeInMs and give the active streams
+        //    Http2DrainTimeoutInMs to finish. Until then all other clients wait in the accept queue.
+        const uint64 connectionStartTimeInMs = getHttp2TimestampInMs();
+        uint64       drainDeadlineInMs       = 0u;
+
+        while ( errorCode == http2_error_code::no_error )
+        {
+            if ( pendingDataSize > 0u )
+            {
+                const size_t freeBytes = Http2ReceiveBufferSize - pConnection->receiveBufferSize;
+                const size_t copySize  = pendingDataSize < freeBytes ? pendingDataSize : freeBytes;
+                copyMemoryNonOverlapping( pConnection->pReceiveBuffer + pConnection->receiveBufferSize, freeBytes, pPendingData, copySize );
+                pConnection->receiveBufferSize += copySize;
+                pPendingData += copySize;
+                pendingDataSize -= copySize;
+            }
+
+            errorCode = processHttp2ReceiveBuffer( pConnection );
+            if ( errorCode != http2_error_code::no_error )
+            {
+                break;
+            }
+
+            if ( writeHttp2StreamData( pConnection ).hasError() || flushHttp2SendBuffer( pConnection ).hasError() )
+            {
+                break;
+            }
+
+            if ( pConnection->isClosing && !hasActiveHttp2Streams( pConnection ) )
+            {
+                break;
+            }
+
+            if ( pendingDataSize > 0u )
+            {
+                continue;
+            }
+
+            const uint64 timestampInMs = getHttp2TimestampInMs();
+            if ( !pConnection->isClosing && timestampInMs - connectionStartTimeInMs >= Http2MaxConnectionLifetimeInMs )
+            {
+                queueHttp2GoAway( pConnection, http2_error_code::no_error );
+                continue;
+            }
+
+            if ( pConnection->isClosing )
+            {
+                //FK: Also covers a GOAWAY sent by the client
+                if ( drainDeadlineInMs == 0u )
+                {
+                    drainDeadlineInMs = timestampInMs + Http2DrainTimeoutInMs;
+                }
+                else if ( timestampInMs >= drainDeadlineInMs )
+                {
+                    cancelActiveHttp2Streams( pConnection );
+                    break;
+                }
+            }
+
+            //FK: Only peek for new frames while there's still body data to send, otherwise block until the idle timeout
+            uint32 waitTimeInMs = hasWritableHttp2StreamData( pConnection ) ? 0u : Http2IdleTimeoutInMs;
+            if ( drainDeadlineInMs != 0u && drainDeadlineInMs - timestampInMs < waitTimeInMs )
+            {
+                waitTimeInMs = ( uint32 )( drainDeadlineInMs - timestampInMs );
+            }
+
+            const http2_wait_result waitResult = waitForHttp2Event( pConnection, waitTimeInMs, !pConnection->isClosing );
+            if ( waitResult == http2_wait_result::error )
+            {
+                break;
+            }
+
+            if ( waitResult == http2_wait_result::pending_connection )
+            {
+                queueHttp2GoAway( pConnection, http2_error_code::no_error );
+                continue;
+            }
+
+            if ( waitResult == http2_wait_result::timeout )
+            {
+                if ( waitTimeInMs == 0u )
+                {
+                    continue;
+                }
+
+                //FK: Idle connection, the server is single threaded so we don't keep it around. Streams that are still
+                //    waiting for a WINDOW_UPDATE get the same drain as after any other GOAWAY
+                if ( !pConnection->isClosing )
+                {
+                    queueHttp2GoAway( pConnection, http2_error_code::no_error );
+                    continue;
+                }
+
+                //FK: Drain timeout ran out
+                cancelActiveHttp2Streams( pConnection );
+                break;
+            }
+
+            if ( receiveHttp2Data( pConnection ).hasError() )
+            {
+                break;
+            }
+        }
+
+        if ( errorCode != http2_error_code::no_error )
+        {
+            queueHttp2GoAway( pConnection, errorCode );
+            flushHttp2SendBuffer( pConnection );
+        }
+
+        destroyHttp2Connection( pConnection );
+    }
+} // namespace k15
+
+#endif //K15_HTTP2_INCLUDE
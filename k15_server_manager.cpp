@@ -1,14 +1,19 @@
 #define _CRT_SECURE_NO_WARNINGS
 #define _WINSOCK_DEPRECATED_NO_WARNINGS
 
-#define WIN32_LEAN_AND_MEAN
-#define NOMINMAX
-#include <winsock2.h>
-#include <windows.h>
+#if defined( _WIN32 )
+#    define WIN32_LEAN_AND_MEAN
+#    define NOMINMAX
+#    include <winsock2.h>
+#    include <windows.h>
+#else
+#    include <unistd.h>
+#endif
 #include <stdio.h>
 
 #include "k15_std/include/k15_base.hpp"
 #include "k15_html_server.hpp"
+#include "k15_server_manager_config.hpp"
 
 #include "k15_std/src/k15_memory.cpp"
 //#include "k15_std/src/k15_format.cpp"
@@ -17,21 +22,69 @@
 #include "k15_std/src/k15_string.cpp"
 #include "k15_std/src/k15_path.cpp"
 #include "k15_std/src/k15_io.cpp"
-#include "k15_std/src/k15_platform_win32.cpp"
-#include "k15_std/src/k15_profiling_win32.cpp"
-#include "k15_std/src/k15_path_win32.cpp"
 
-#pragma comment( lib, "kernel32.lib" )
-#pragma comment( lib, "user32.lib" )
-#pragma comment( lib, "ws2_32.lib" )
+#if defined( _WIN32 )
+#    include "k15_std/src/k15_platform_win32.cpp"
+#    include "k15_std/src/k15_profiling_win32.cpp"
+#    include "k15_std/src/k15_path_win32.cpp"
 
-#define K15_FALSE 0
-#define K15_TRUE  1
+#    pragma comment( lib, "kernel32.lib" )
+#    pragma comment( lib, "user32.lib" )
+#    pragma comment( lib, "ws2_32.lib" )
+#else
+#    include "k15_std/src/k15_platform_linux.cpp"
+#    include "k15_std/src/k15_profiling_linux.cpp"
+#    include "k15_std/src/k15_path_linux.cpp"
+#endif
 
 using namespace k15;
 
-typedef LRESULT( CALLBACK* WNDPROC )( HWND, UINT, WPARAM, LPARAM );
+int runServerManager( const server_manager_config& config )
+{
+    if ( !initializeSocketLayer() )
+    {
+        printf( "Couldn't initialize socket layer...\n" );
+        return -1;
+    }
+
+    html_server_parameters parameters;
+    fillHtmlServerParameters( &parameters, config, getCrtMemoryAllocator() );
+
+    //FK: The status board is optional, without it the server just doesn't answer /api/servers
+    k15_status_board statusBoard;
+    statusBoard.pSegment = nullptr;
+    if ( config.statusBoardName[ 0 ] != 0 )
+    {
+        if ( k15_createStatusBoard( &statusBoard, config.statusBoardName ) )
+        {
+            parameters.pStatusBoard = &statusBoard;
+        }
+        else
+        {
+            printf( "Couldn't create status board '%s'.\n", config.statusBoardName );
+        }
+    }
+
+    result< html_server* > initResult = createHtmlServer( parameters );
+    if ( initResult.hasError() )
+    {
+        printf( "Couldn't initialize html server on port %d.\n", config.port );
+        k15_closeStatusBoard( &statusBoard );
+        shutdownSocketLayer();
+        return -1;
+    }
+
+    html_server* pServer = initResult.getValue();
+    const bool   served  = serveHtmlClients( pServer );
+
+    destroyHtmlServer( pServer );
+    k15_closeStatusBoard( &statusBoard );
+    shutdownSocketLayer();
 
+    return served ? 0 : -1;
+}
+
+#if defined( _WIN32 )
 void printErrorToFile( const char* p_FileName )
 {
     DWORD errorId      = GetLastError();
@@ -59,158 +112,47 @@ void allocateDebugConsole()
     freopen( "CONOUT$", "w", stdout );
 }
 
-void K15_WindowCreated( HWND p_HWND, UINT p_Message, WPARAM p_wParam, LPARAM p_lParam )
-{
-}
-
-void K15_WindowClosed( HWND p_HWND, UINT p_Message, WPARAM p_wParam, LPARAM p_lParam )
-{
-}
-
-void K15_KeyInput( HWND p_HWND, UINT p_Message, WPARAM p_wParam, LPARAM p_lParam )
-{
-}
-
-void K15_MouseButtonInput( HWND p_HWND, UINT p_Message, WPARAM p_wParam, LPARAM p_lParam )
-{
-}
-
-void K15_MouseMove( HWND p_HWND, UINT p_Message, WPARAM p_wParam, LPARAM p_lParam )
-{
-}
-
-void K15_MouseWheel( HWND p_HWND, UINT p_Message, WPARAM p_wParam, LPARAM p_lParam )
-{
-}
-
-LRESULT CALLBACK K15_WNDPROC( HWND p_HWND, UINT p_Message, WPARAM p_wParam, LPARAM p_lParam )
-{
-    bool8 messageHandled = K15_FALSE;
-
-    switch ( p_Message )
-    {
-    case WM_CREATE:
-        K15_WindowCreated( p_HWND, p_Message, p_wParam, p_lParam );
-        break;
-
-    case WM_CLOSE:
-        K15_WindowClosed( p_HWND, p_Message, p_wParam, p_lParam );
-        PostQuitMessage( 0 );
-        messageHandled = K15_TRUE;
-        break;
-
-    case WM_KEYDOWN:
-    case WM_KEYUP:
-    case WM_SYSKEYDOWN:
-    case WM_SYSKEYUP:
-        K15_KeyInput( p_HWND, p_Message, p_wParam, p_lParam );
-        break;
-
-    case WM_LBUTTONUP:
-    case WM_MBUTTONUP:
-    case WM_RBUTTONUP:
-    case WM_XBUTTONUP:
-    case WM_LBUTTONDOWN:
-    case WM_RBUTTONDOWN:
-    case WM_MBUTTONDOWN:
-    case WM_XBUTTONDOWN:
-        K15_MouseButtonInput( p_HWND, p_Message, p_wParam, p_lParam );
-        break;
-
-    case WM_MOUSEMOVE:
-        K15_MouseMove( p_HWND, p_Message, p_wParam, p_lParam );
-        break;
-
-    case WM_MOUSEWHEEL:
-        K15_MouseWheel( p_HWND, p_Message, p_wParam, p_lParam );
-        break;
-    }
-
-    if ( messageHandled == K15_FALSE )
-    {
-        return DefWindowProc( p_HWND, p_Message, p_wParam, p_lParam );
-    }
-
-    return 0;
-}
-
-HWND setupWindow( HINSTANCE p_Instance, int p_Width, int p_Height )
-{
-    WNDCLASS wndClass      = { 0 };
-    wndClass.style         = CS_HREDRAW | CS_OWNDC | CS_VREDRAW;
-    wndClass.hInstance     = p_Instance;
-    wndClass.lpszClassName = "K15_Win32Template";
-    wndClass.lpfnWndProc   = K15_WNDPROC;
-    wndClass.hCursor       = LoadCursor( NULL, IDC_ARROW );
-    RegisterClass( &wndClass );
-
-    HWND hwnd = CreateWindowA( "K15_Win32Template", "Win32 Template",
-                               WS_OVERLAPPEDWINDOW, CW_USEDEFAULT, CW_USEDEFAULT,
-                               p_Width, p_Height, 0, 0, p_Instance, 0 );
-
-    if ( hwnd == INVALID_HANDLE_VALUE )
-        MessageBox( 0, "Error creating Window.\n", "Error!", 0 );
-    else
-        ShowWindow( hwnd, SW_SHOW );
-    return hwnd;
-}
-
-uint32 getTimeInMilliseconds( LARGE_INTEGER p_PerformanceFrequency )
-{
-    LARGE_INTEGER appTime = { 0 };
-    QueryPerformanceFrequency( &appTime );
-
-    appTime.QuadPart *= 1000; //to milliseconds
-
-    return ( uint32 )( appTime.QuadPart / p_PerformanceFrequency.QuadPart );
-}
-
-void setup()
-{
-    allocateDebugConsole();
-}
-
-void doFrame( uint32 p_DeltaTimeInMS )
-{
-}
-
 int CALLBACK WinMain( HINSTANCE hInstance,
                       HINSTANCE hPrevInstance,
                       LPSTR lpCmdLine, int nShowCmd )
 {
-    LARGE_INTEGER performanceFrequency;
-    QueryPerformanceFrequency( &performanceFrequency );
+    allocateDebugConsole();
 
-    //FK: TODO: WSAGetLastError error handling
-    setup();
+    server_manager_config config;
+    setDefaultServerManagerConfig( &config );
 
-    WSADATA wsa;
-    if ( WSAStartup( MAKEWORD( 2, 2 ), &wsa ) != 0 )
+    const result< void > configResult = parseServerManagerCommandLine( &config, __argc, __argv );
+    if ( configResult.hasError() )
     {
-        printf( "WSAStartup failed...\n" );
+        printf( "Couldn't load server manager config.\n" );
         return -1;
     }
 
-    char currentDirectory[ MAX_PATH ];
-    GetCurrentDirectoryA( MAX_PATH, currentDirectory );
-
-    html_server_parameters parameters;
-    parameters.port             = 9090;
-    parameters.pIpv4BindAddress = "0.0.0.0";
-    parameters.pIpv6BindAddress = "::0";
-    parameters.pAllocator       = getCrtMemoryAllocator();
-    parameters.pRootDirectory   = "html/";
-    parameters.pLogFilePath     = "html_log.txt";
+    return runServerManager( config );
+}
+#else
+int main( int argc, char** argv )
+{
+    server_manager_config config;
+    setDefaultServerManagerConfig( &config );
 
-    result< html_server* > initResult = createHtmlServer( parameters );
-    if ( initResult.hasError() )
+    const result< void > configResult = parseServerManagerCommandLine( &config, argc, argv );
+    if ( configResult.hasError() )
     {
-        printf( "Couldn't initialize html server.\n" );
+        printf( "Couldn't load server manager config.\n" );
         return -1;
     }
 
-    html_server* pServer = initResult.getValue();
-    return serveHtmlClients( pServer );
+    if ( config.daemonize )
+    {
+        //FK: Keep the working directory, root_directory and log_file are usually relative to it
+        if ( daemon( 1, 0 ) != 0 )
+        {
+            printf( "Couldn't detach from terminal.\n" );
+            return -1;
+        }
+    }
 
-    return 0;
-}
\ No newline at end of file
+    return runServerManager( config );
+}
+#endif
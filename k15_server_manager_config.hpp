@@ -0,0 +1,247 @@
+#ifndef K15_SERVER_MANAGER_CONFIG_INCLUDE
+#define K15_SERVER_MANAGER_CONFIG_INCLUDE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "k15_html_server.hpp"
+
+namespace k15
+{
+    enum : uint16
+    {
+        ConfigValueLength = 256
+    };
+
+    struct server_manager_config
+    {
+        int  port;
+        char ipv4BindAddress[ ConfigValueLength ];
+        char ipv6BindAddress[ ConfigValueLength ];
+        char rootDirectory[ ConfigValueLength ];
+        char logFilePath[ ConfigValueLength ];
+        char statusBoardName[ ConfigValueLength ]; //FK: Shared memory name of the game server status board, empty disables it
+        bool onlyServeBelowRoot;
+        bool autoIndexDirectories;
+        bool daemonize; //FK: Only evaluated by the linux entry point
+    };
+
+    const char* defaultServerManagerConfigPath = "k15_server_manager.cfg";
+
+    void copyConfigValue( char* pTarget, const char* pValue )
+    {
+        const size_t valueLength = strlen( pValue );
+        const size_t copyLength  = valueLength < ConfigValueLength - 1 ? valueLength : ConfigValueLength - 1;
+        copyMemoryNonOverlapping( pTarget, ConfigValueLength, pValue, copyLength );
+        pTarget[ copyLength ] = 0;
+    }
+
+    bool parseConfigBool( const char* pValue )
+    {
+        return strcmp( pValue, "true" ) == 0 || strcmp( pValue, "yes" ) == 0 || strcmp( pValue, "1" ) == 0;
+    }
+
+    char* trimConfigToken( char* pToken )
+    {
+        while ( *pToken == ' ' || *pToken == '\t' )
+        {
+            ++pToken;
+        }
+
+        char* pTokenEnd = pToken + strlen( pToken );
+        while ( pTokenEnd > pToken && ( pTokenEnd[ -1 ] == ' ' || pTokenEnd[ -1 ] == '\t' || pTokenEnd[ -1 ] == '\r' || pTokenEnd[ -1 ] == '\n' ) )
+        {
+            --pTokenEnd;
+        }
+
+        *pTokenEnd = 0;
+        return pToken;
+    }
+
+    void setDefaultServerManagerConfig( server_manager_config* pConfig )
+    {
+        pConfig->port                 = 9090;
+        pConfig->onlyServeBelowRoot   = true;
+        pConfig->autoIndexDirectories = true;
+        pConfig->daemonize            = false;
+        copyConfigValue( pConfig->ipv4BindAddress, "0.0.0.0" );
+        copyConfigValue( pConfig->ipv6BindAddress, "::" );
+        copyConfigValue( pConfig->rootDirectory, "html/" );
+        copyConfigValue( pConfig->logFilePath, "html_log.txt" );
+        copyConfigValue( pConfig->statusBoardName, K15_STATUS_BOARD_DEFAULT_NAME );
+    }
+
+    result< void > setServerManagerConfigValue( server_manager_config* pConfig, const char* pKey, const char* pValue )
+    {
+        if ( strcmp( pKey, "port" ) == 0 )
+        {
+            const int port = atoi( pValue );
+            if ( port <= 0 || port > 65535 )
+            {
+                return error_id::parse_error;
+            }
+
+            pConfig->port = port;
+        }
+        else if ( strcmp( pKey, "ipv4_bind_address" ) == 0 )
+        {
+            copyConfigValue( pConfig->ipv4BindAddress, pValue );
+        }
+        else if ( strcmp( pKey, "ipv6_bind_address" ) == 0 )
+        {
+            copyConfigValue( pConfig->ipv6BindAddress, pValue );
+        }
+        else if ( strcmp( pKey, "root_directory" ) == 0 )
+        {
+            copyConfigValue( pConfig->rootDirectory, pValue );
+        }
+        else if ( strcmp( pKey, "log_file" ) == 0 )
+        {
+            copyConfigValue( pConfig->logFilePath, pValue );
+        }
+        else if ( strcmp( pKey, "status_board" ) == 0 )
+        {
+            copyConfigValue( pConfig->statusBoardName, pValue );
+        }
+        else if ( strcmp( pKey, "only_serve_below_root" ) == 0 )
+        {
+            pConfig->onlyServeBelowRoot = parseConfigBool( pValue );
+        }
+        else if ( strcmp( pKey, "auto_index" ) == 0 )
+        {
+            pConfig->autoIndexDirectories = parseConfigBool( pValue );
+        }
+        else if ( strcmp( pKey, "daemonize" ) == 0 )
+        {
+            pConfig->daemonize = parseConfigBool( pValue );
+        }
+        else
+        {
+            return error_id::not_supported;
+        }
+
+        return error_id::success;
+    }
+
+    //FK: Config format is one 'key = value' pair per line, '#' starts a comment
+    result< void > loadServerManagerConfig( server_manager_config* pConfig, const char* pConfigFilePath )
+    {
+        FILE* pConfigFile = fopen( pConfigFilePath, "r" );
+        if ( pConfigFile == nullptr )
+        {
+            return error_id::not_found;
+        }
+
+        char line[ 512 ];
+        while ( fgets( line, sizeof( line ), pConfigFile ) != nullptr )
+        {
+            char* pComment = strchr( line, '#' );
+            if ( pComment != nullptr )
+            {
+                *pComment = 0;
+            }
+
+            char* pSeparator = strchr( line, '=' );
+            if ( pSeparator == nullptr )
+            {
+                if ( *trimConfigToken( line ) != 0 )
+                {
+                    fclose( pConfigFile );
+                    return error_id::parse_error;
+                }
+
+                continue;
+            }
+
+            *pSeparator = 0;
+
+            const char*          pKey           = trimConfigToken( line );
+            const char*          pValue         = trimConfigToken( pSeparator + 1 );
+            const result< void > setValueResult = setServerManagerConfigValue( pConfig, pKey, pValue );
+            if ( setValueResult.hasError() )
+            {
+                printf( "Invalid config entry '%s' in '%s'.\n", pKey, pConfigFilePath );
+                fclose( pConfigFile );
+                return setValueResult;
+            }
+        }
+
+        fclose( pConfigFile );
+        return error_id::success;
+    }
+
+    //FK: Supported arguments: --config <path>, --port <port>, --root <directory>, --daemon
+    result< void > parseServerManagerCommandLine( server_manager_config* pConfig, int argc, char** argv )
+    {
+        const char* pConfigFilePath      = defaultServerManagerConfigPath;
+        bool        configPathIsExplicit = false;
+
+        for ( int argIndex = 1; argIndex < argc; ++argIndex )
+        {
+            if ( strcmp( argv[ argIndex ], "--config" ) == 0 && argIndex + 1 < argc )
+            {
+                pConfigFilePath      = argv[ ++argIndex ];
+                configPathIsExplicit = true;
+            }
+        }
+
+        const result< void > loadResult = loadServerManagerConfig( pConfig, pConfigFilePath );
+        if ( loadResult.hasError() )
+        {
+            //FK: Running without a config file is fine as long as nobody asked for a specific one
+            if ( configPathIsExplicit || loadResult.getError() != error_id::not_found )
+            {
+                return loadResult;
+            }
+        }
+
+        //FK: Command line arguments override whatever is in the config file
+        for ( int argIndex = 1; argIndex < argc; ++argIndex )
+        {
+            const char* pArg = argv[ argIndex ];
+            if ( strcmp( pArg, "--config" ) == 0 )
+            {
+                ++argIndex;
+            }
+            else if ( strcmp( pArg, "--daemon" ) == 0 )
+            {
+                pConfig->daemonize = true;
+            }
+            else if ( strcmp( pArg, "--port" ) == 0 && argIndex + 1 < argc )
+            {
+                const result< void > setValueResult = setServerManagerConfigValue( pConfig, "port", argv[ ++argIndex ] );
+                if ( setValueResult.hasError() )
+                {
+                    return setValueResult;
+                }
+            }
+            else if ( strcmp( pArg, "--root" ) == 0 && argIndex + 1 < argc )
+            {
+                copyConfigValue( pConfig->rootDirectory, argv[ ++argIndex ] );
+            }
+            else
+            {
+                printf( "Unknown argument '%s'.\n", pArg );
+                return error_id::not_supported;
+            }
+        }
+
+        return error_id::success;
+    }
+
+    void fillHtmlServerParameters( html_server_parameters* pParameters, const server_manager_config& config, memory_allocator* pAllocator )
+    {
+        pParameters->pAllocator           = pAllocator;
+        pParameters->port                 = config.port;
+        pParameters->pIpv4BindAddress     = config.ipv4BindAddress;
+        pParameters->pIpv6BindAddress     = config.ipv6BindAddress;
+        pParameters->pRootDirectory       = config.rootDirectory;
+        pParameters->pLogFilePath         = config.logFilePath[ 0 ] != 0 ? config.logFilePath : nullptr;
+        pParameters->onlyServeBelowRoot   = config.onlyServeBelowRoot;
+        pParameters->autoIndexDirectories = config.autoIndexDirectories;
+        pParameters->pStatusBoard         = nullptr;
+    }
+} // namespace k15
+
+#endif //K15_SERVER_MANAGER_CONFIG_INCLUDE
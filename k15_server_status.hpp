@@ -0,0 +1,165 @@
+#ifndef K15_SERVER_STATUS_INCLUDE
+#define K15_SERVER_STATUS_INCLUDE
+
+#include "k15_std/include/k15_base.hpp"
+#include "k15_std/include/k15_memory.hpp"
+
+#include "k15_status_board.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace k15
+{
+    enum : uint32
+    {
+        ServerStatusDocumentSize = 32u * 1024u //FK: worst case for a full board with fully escaped names is ~26KiB
+    };
+
+    const char* serverStatusApiPath = "/api/servers";
+
+    //FK: /api/servers response. Rendered in one go from a snapshot of the status board and handed out in chunks afterwards,
+    //    so a slow client never holds up the snapshot
+    struct server_status_document
+    {
+        char   text[ ServerStatusDocumentSize ];
+        size_t size;
+        size_t readOffset;
+    };
+
+    const char* getServerStateName( uint32 state )
+    {
+        switch ( state )
+        {
+        case K15_SERVER_STATE_STARTING:
+            return "starting";
+        case K15_SERVER_STATE_RUNNING:
+            return "running";
+        case K15_SERVER_STATE_STOPPING:
+            return "stopping";
+        }
+
+        return "unknown";
+    }
+
+    bool appendToServerStatusDocument( server_status_document* pDocument, const char* pText, size_t textLength )
+    {
+        if ( pDocument->size + textLength > ServerStatusDocumentSize )
+        {
+            return false;
+        }
+
+        copyMemoryNonOverlapping( pDocument->text + pDocument->size, ServerStatusDocumentSize - pDocument->size, pText, textLength );
+        pDocument->size += textLength;
+        return true;
+    }
+
+    bool appendFormattedToServerStatusDocument( server_status_document* pDocument, const char* pFormat, ... )
+    {
+        va_list arguments;
+        va_start( arguments, pFormat );
+        const size_t remainingSize = ServerStatusDocumentSize - pDocument->size;
+        const int    textLength    = vsnprintf( pDocument->text + pDocument->size, remainingSize, pFormat, arguments );
+        va_end( arguments );
+
+        if ( textLength < 0 || ( size_t )textLength >= remainingSize )
+        {
+            return false;
+        }
+
+        pDocument->size += ( size_t )textLength;
+        return true;
+    }
+
+    //FK: Names come straight from the game servers, so quotes and control characters have to be escaped
+    bool appendJsonEscapedToServerStatusDocument( server_status_document* pDocument, const char* pText, size_t maxTextLength )
+    {
+        for ( size_t charIndex = 0u; charIndex < maxTextLength && pText[ charIndex ] != 0; ++charIndex )
+        {
+            const unsigned char character = ( unsigned char )pText[ charIndex ];
+
+            bool appended = false;
+            if ( character == '"' || character == '\\' )
+            {
+                const char escapedCharacter[] = { '\\', ( char )character };
+                appended                      = appendToServerStatusDocument( pDocument, escapedCharacter, sizeof( escapedCharacter ) );
+            }
+            else if ( character < 0x20u )
+            {
+                appended = appendFormattedToServerStatusDocument( pDocument, "\\u%04x", character );
+            }
+            else
+            {
+                appended = appendToServerStatusDocument( pDocument, ( const char* )&character, 1u );
+            }
+
+            if ( !appended )
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool appendServerStatusEntry( server_status_document* pDocument, uint32 slotIndex, const k15_status_board_slot& slot, uint64 timestampInMs, bool isFirstEntry )
+    {
+        //FK: A heartbeat from the future just means the game server read the clock after we did
+        const uint64 heartbeatAgeInMs = timestampInMs > slot.heartbeatTimestampInMs ? timestampInMs - slot.heartbeatTimestampInMs : 0u;
+
+        return appendFormattedToServerStatusDocument( pDocument, "%s{\"slot\":%u,\"pid\":%u,\"name\":\"", isFirstEntry ? "" : ",", slotIndex, slot.ownerProcessId ) &&
+               appendJsonEscapedToServerStatusDocument( pDocument, slot.name, K15_STATUS_BOARD_NAME_LENGTH ) &&
+               appendFormattedToServerStatusDocument( pDocument,
+                                                      "\",\"state\":\"%s\",\"port\":%u,\"players\":%u,\"max_players\":%u,\"tick_time_us\":%u,\"heartbeat_age_ms\":%llu}",
+                                                      getServerStateName( slot.state ), ( uint32 )slot.port, ( uint32 )slot.playerCount,
+                                                      ( uint32 )slot.maxPlayerCount, slot.tickTimeInMicroseconds, ( unsigned long long )heartbeatAgeInMs );
+    }
+
+    result< void > renderServerStatusDocument( server_status_document* pDocument, const k15_status_board* pBoard )
+    {
+        pDocument->size       = 0u;
+        pDocument->readOffset = 0u;
+
+        //FK: Copy all slots first and render afterwards, keeps the time between the first and the last read as short as possible
+        k15_status_board_slot slots[ K15_STATUS_BOARD_SLOT_COUNT ];
+        bool                  isSlotInUse[ K15_STATUS_BOARD_SLOT_COUNT ];
+        for ( uint32 slotIndex = 0u; slotIndex < K15_STATUS_BOARD_SLOT_COUNT; ++slotIndex )
+        {
+            isSlotInUse[ slotIndex ] = k15_readStatusBoardSlot( pBoard, slotIndex, slots + slotIndex ) != 0;
+        }
+
+        const uint64 timestampInMs = k15_getStatusBoardTimestampInMs();
+
+        bool rendered = appendFormattedToServerStatusDocument( pDocument, "{\"slot_count\":%u,\"servers\":[", K15_STATUS_BOARD_SLOT_COUNT );
+
+        bool isFirstEntry = true;
+        for ( uint32 slotIndex = 0u; rendered && slotIndex < K15_STATUS_BOARD_SLOT_COUNT; ++slotIndex )
+        {
+            if ( !isSlotInUse[ slotIndex ] )
+            {
+                continue;
+            }
+
+            rendered     = appendServerStatusEntry( pDocument, slotIndex, slots[ slotIndex ], timestampInMs, isFirstEntry );
+            isFirstEntry = false;
+        }
+
+        rendered = rendered && appendToServerStatusDocument( pDocument, "]}\n", 3u );
+        return rendered ? error_id::success : error_id::out_of_memory;
+    }
+
+    //FK: html_chunk_producer for a rendered server_status_document
+    result< size_t > produceServerStatusChunk( void* pUserData, char* pBuffer, size_t bufferSizeInBytes )
+    {
+        server_status_document* pDocument      = ( server_status_document* )pUserData;
+        const size_t            remainingSize  = pDocument->size - pDocument->readOffset;
+        const size_t            bytesToProduce = remainingSize < bufferSizeInBytes ? remainingSize : bufferSizeInBytes;
+
+        copyMemoryNonOverlapping( pBuffer, bufferSizeInBytes, pDocument->text + pDocument->readOffset, bytesToProduce );
+        pDocument->readOffset += bytesToProduce;
+        return bytesToProduce;
+    }
+} // namespace k15
+
+#endif //K15_SERVER_STATUS_INCLUDE
@@ -0,0 +1,147 @@
+#ifndef K15_SOCKET_INCLUDE
+#define K15_SOCKET_INCLUDE
+
+#include "k15_std/include/k15_base.hpp"
+
+#if defined( _WIN32 )
+#    include <winsock2.h>
+#    include <ws2tcpip.h>
+#else
+#    include <sys/types.h>
+#    include <sys/socket.h>
+#    include <sys/select.h>
+#    include <netinet/in.h>
+#    include <netinet/tcp.h>
+#    include <arpa/inet.h>
+#    include <unistd.h>
+#    include <errno.h>
+#    include <signal.h>
+#endif
+
+namespace k15
+{
+#if defined( _WIN32 )
+    typedef SOCKET socketId;
+
+    constexpr socketId invalidSocket = INVALID_SOCKET;
+    constexpr int      socketError   = SOCKET_ERROR;
+#else
+    typedef int socketId;
+
+    constexpr socketId invalidSocket = -1;
+    constexpr int      socketError   = -1;
+#endif
+
+    bool initializeSocketLayer()
+    {
+#if defined( _WIN32 )
+        WSADATA wsa;
+        return WSAStartup( MAKEWORD( 2, 2 ), &wsa ) == 0;
+#else
+        //FK: A client that hangs up mid-response should surface as EPIPE from send(), not kill the process
+        signal( SIGPIPE, SIG_IGN );
+        return true;
+#endif
+    }
+
+    void shutdownSocketLayer()
+    {
+#if defined( _WIN32 )
+        WSACleanup();
+#endif
+    }
+
+    void closeSocket( socketId socket )
+    {
+#if defined( _WIN32 )
+        closesocket( socket );
+#else
+        close( socket );
+#endif
+    }
+
+    int getLastSocketError()
+    {
+#if defined( _WIN32 )
+        return WSAGetLastError();
+#else
+        return errno;
+#endif
+    }
+
+    void clearLastSocketError()
+    {
+#if defined( _WIN32 )
+        WSASetLastError( 0 );
+#else
+        errno = 0;
+#endif
+    }
+
+    bool isTransientSocketError( int socketErrorCode )
+    {
+#if defined( _WIN32 )
+        return socketErrorCode == WSAEINTR || socketErrorCode == WSAEWOULDBLOCK;
+#else
+        return socketErrorCode == EINTR || socketErrorCode == EAGAIN || socketErrorCode == EWOULDBLOCK;
+#endif
+    }
+
+    bool isInterruptedSocketError( int socketErrorCode )
+    {
+#if defined( _WIN32 )
+        return socketErrorCode == WSAEINTR;
+#else
+        return socketErrorCode == EINTR;
+#endif
+    }
+
+    int sendOnSocket( socketId socket, const char* pData, size_t dataSizeInBytes )
+    {
+#if defined( _WIN32 )
+        return send( socket, pData, ( int )dataSizeInBytes, 0 );
+#else
+        return ( int )send( socket, pData, dataSizeInBytes, MSG_NOSIGNAL );
+#endif
+    }
+
+    int receiveFromSocket( socketId socket, char* pBuffer, size_t bufferSizeInBytes )
+    {
+#if defined( _WIN32 )
+        return recv( socket, pBuffer, ( int )bufferSizeInBytes, 0 );
+#else
+        return ( int )recv( socket, pBuffer, bufferSizeInBytes, 0 );
+#endif
+    }
+
+    bool setSocketOption( socketId socket, int level, int option, int value )
+    {
+        return setsockopt( socket, level, option, ( const char* )&value, sizeof( value ) ) != socketError;
+    }
+
+    //FK: select() wants the highest descriptor + 1 on posix and ignores the value on win32
+    int getSelectDescriptorCount( socketId socketA, socketId socketB )
+    {
+#if defined( _WIN32 )
+        return 0;
+#else
+        const socketId maxSocket = socketA > socketB ? socketA : socketB;
+        return maxSocket + 1;
+#endif
+    }
+
+    //FK: Blocking send() gives up after the timeout, fails with EAGAIN on posix and WSAETIMEDOUT on win32
+    bool setSocketSendTimeout( socketId socket, uint32 timeoutInMilliseconds )
+    {
+#if defined( _WIN32 )
+        const DWORD timeout = ( DWORD )timeoutInMilliseconds;
+#else
+        timeval timeout;
+        timeout.tv_sec  = ( long )( timeoutInMilliseconds / 1000u );
+        timeout.tv_usec = ( long )( ( timeoutInMilliseconds % 1000u ) * 1000u );
+#endif
+        return setsockopt( socket, SOL_SOCKET, SO_SNDTIMEO, ( const char* )&timeout, sizeof( timeout ) ) != socketError;
+    }
+} // namespace k15
+
+#endif //K15_SOCKET_INCLUDE
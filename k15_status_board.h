@@ -0,0 +1,494 @@
+#ifndef K15_STATUS_BOARD_INCLUDE
+#define K15_STATUS_BOARD_INCLUDE
+
+/*FK: Shared memory status board, game servers publish their state here and the server manager reads it.
+      Plain C so game servers can include it directly, everything is header only.
+
+      Game server side:
+        k15_status_board board;
+        k15_openStatusBoard( &board, K15_STATUS_BOARD_DEFAULT_NAME );
+        k15_status_board_slot* pSlot = k15_claimStatusBoardSlot( &board, "de_dust2", 27015 );
+
+        //FK: once per tick (at least every K15_STATUS_BOARD_STALE_MS, otherwise the slot can be taken over),
+        //    gather everything up front to keep the update window short
+        const uint64_t timestamp = k15_getStatusBoardTimestampInMs();
+        k15_beginStatusBoardSlotUpdate( pSlot );
+        pSlot->playerCount            = playerCount;
+        pSlot->tickTimeInMicroseconds = tickTime;
+        pSlot->heartbeatTimestampInMs = timestamp;
+        k15_endStatusBoardSlotUpdate( pSlot );
+
+        k15_releaseStatusBoardSlot( pSlot );
+        k15_closeStatusBoard( &board );
+
+      Every slot sits on its own cache line and is guarded by a seqlock: the owner makes the sequence odd while writing,
+      readers copy the slot and retry if the sequence was odd or changed in the meantime. Neither side takes a lock or
+      makes a syscall after the board has been mapped.
+
+      Needs POSIX.1-2008 (clock_gettime, kill, ftruncate, shm_open) on non-windows platforms. Strict -std=c99/c11 hides
+      those, so _POSIX_C_SOURCE gets defined here if nobody did - that only works if this header is included before any
+      system header, otherwise define _POSIX_C_SOURCE=200809L (or use -std=gnu99/gnu11) yourself.*/
+
+#if !defined( _WIN32 ) && !defined( _POSIX_C_SOURCE )
+#    define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined( _WIN32 )
+#    ifndef WIN32_LEAN_AND_MEAN
+#        define WIN32_LEAN_AND_MEAN
+#    endif
+#    include <windows.h>
+#    include <intrin.h>
+#else
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <errno.h>
+#    include <fcntl.h>
+#    include <signal.h>
+#    include <time.h>
+#    include <unistd.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined( _WIN32 )
+#    define K15_STATUS_BOARD_DEFAULT_NAME "Local\\k15_status_board"
+#else
+#    define K15_STATUS_BOARD_DEFAULT_NAME "/k15_status_board"
+#endif
+
+#define K15_STATUS_BOARD_MAGIC          0x4253354bu /*FK: 'K5SB'*/
+#define K15_STATUS_BOARD_VERSION        1u
+#define K15_STATUS_BOARD_SLOT_COUNT     64u
+#define K15_STATUS_BOARD_CACHE_LINE     64u
+#define K15_STATUS_BOARD_NAME_LENGTH    32u
+#define K15_STATUS_BOARD_READ_RETRIES   1024u
+#define K15_STATUS_BOARD_STALE_MS       5000u  /*FK: owners have to heartbeat at least this often to keep their slot*/
+#define K15_STATUS_BOARD_ABANDONED_MS   60000u /*FK: stale for this long, the slot is taken over even if the pid looks alive*/
+
+#if defined( _MSC_VER )
+#    define K15_STATUS_BOARD_ALIGN __declspec( align( 64 ) )
+#else
+#    define K15_STATUS_BOARD_ALIGN __attribute__( ( aligned( 64 ) ) )
+#endif
+
+typedef enum k15_server_state
+{
+    K15_SERVER_STATE_STARTING = 0,
+    K15_SERVER_STATE_RUNNING  = 1,
+    K15_SERVER_STATE_STOPPING = 2
+} k15_server_state;
+
+/*FK: Fixed layout, exactly one cache line so writers of neighbouring slots never share a line*/
+typedef struct K15_STATUS_BOARD_ALIGN k15_status_board_slot
+{
+    uint32_t sequence;       /*FK: odd while the owner is writing*/
+    uint32_t ownerProcessId; /*FK: 0 marks a free slot*/
+    uint32_t state;          /*FK: k15_server_state*/
+    uint16_t port;
+    uint16_t playerCount;
+    uint16_t maxPlayerCount;
+    uint16_t reserved;
+    uint32_t tickTimeInMicroseconds;
+    uint64_t heartbeatTimestampInMs; /*FK: k15_getStatusBoardTimestampInMs()*/
+    char     name[ K15_STATUS_BOARD_NAME_LENGTH ]; /*FK: not necessarily zero terminated*/
+} k15_status_board_slot;
+
+/*FK: Poor man's static assert that works for C99 and C++ alike*/
+typedef char k15_status_board_slot_size_check[ sizeof( k15_status_board_slot ) == K15_STATUS_BOARD_CACHE_LINE ? 1 : -1 ];
+
+typedef struct K15_STATUS_BOARD_ALIGN k15_status_board_header
+{
+    uint32_t magic; /*FK: written last, the board isn't usable before*/
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotSizeInBytes;
+} k15_status_board_header;
+
+typedef struct k15_status_board_segment
+{
+    k15_status_board_header header;
+    k15_status_board_slot   slots[ K15_STATUS_BOARD_SLOT_COUNT ];
+} k15_status_board_segment;
+
+typedef struct k15_status_board
+{
+    k15_status_board_segment* pSegment;
+#if defined( _WIN32 )
+    HANDLE mappingHandle;
+#endif
+} k15_status_board;
+
+#if defined( _MSC_VER )
+/*FK: x86/x64 only, loads and stores already have acquire/release semantics there so keeping the compiler in check is enough*/
+static inline uint32_t k15_loadStatusBoardAcquire( const uint32_t* pValue )
+{
+    const uint32_t value = *( const volatile uint32_t* )pValue;
+    _ReadWriteBarrier();
+    return value;
+}
+
+static inline void k15_storeStatusBoardRelease( uint32_t* pValue, uint32_t value )
+{
+    _ReadWriteBarrier();
+    *( volatile uint32_t* )pValue = value;
+}
+
+static inline void k15_storeStatusBoardRelaxed( uint32_t* pValue, uint32_t value )
+{
+    *( volatile uint32_t* )pValue = value;
+}
+
+static inline int k15_compareExchangeStatusBoard( uint32_t* pValue, uint32_t expected, uint32_t desired )
+{
+    return ( uint32_t )_InterlockedCompareExchange( ( volatile long* )pValue, ( long )desired, ( long )expected ) == expected;
+}
+
+static inline void k15_acquireStatusBoardFence( void )
+{
+    _ReadWriteBarrier();
+}
+
+static inline void k15_releaseStatusBoardFence( void )
+{
+    _ReadWriteBarrier();
+}
+
+static inline void k15_pauseStatusBoardReader( void )
+{
+    _mm_pause();
+}
+#else
+static inline uint32_t k15_loadStatusBoardAcquire( const uint32_t* pValue )
+{
+    return __atomic_load_n( pValue, __ATOMIC_ACQUIRE );
+}
+
+static inline void k15_storeStatusBoardRelease( uint32_t* pValue, uint32_t value )
+{
+    __atomic_store_n( pValue, value, __ATOMIC_RELEASE );
+}
+
+static inline void k15_storeStatusBoardRelaxed( uint32_t* pValue, uint32_t value )
+{
+    __atomic_store_n( pValue, value, __ATOMIC_RELAXED );
+}
+
+static inline int k15_compareExchangeStatusBoard( uint32_t* pValue, uint32_t expected, uint32_t desired )
+{
+    return __atomic_compare_exchange_n( pValue, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+}
+
+static inline void k15_acquireStatusBoardFence( void )
+{
+    __atomic_thread_fence( __ATOMIC_ACQUIRE );
+}
+
+static inline void k15_releaseStatusBoardFence( void )
+{
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+}
+
+/*FK: Backs off while the owner is mid-update, so the reader doesn't keep stealing the cache line from the writer*/
+static inline void k15_pauseStatusBoardReader( void )
+{
+#    if defined( __x86_64__ ) || defined( __i386__ )
+    __builtin_ia32_pause();
+#    elif defined( __aarch64__ )
+    __asm__ __volatile__( "yield" );
+#    endif
+}
+#endif
+
+/*FK: Monotonic milliseconds, comparable between processes on the same machine (vDSO on linux, no syscall)*/
+static inline uint64_t k15_getStatusBoardTimestampInMs( void )
+{
+#if defined( _WIN32 )
+    return ( uint64_t )GetTickCount64();
+#else
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return ( uint64_t )now.tv_sec * 1000u + ( uint64_t )now.tv_nsec / 1000000u;
+#endif
+}
+
+static inline uint32_t k15_getStatusBoardProcessId( void )
+{
+#if defined( _WIN32 )
+    return ( uint32_t )GetCurrentProcessId();
+#else
+    return ( uint32_t )getpid();
+#endif
+}
+
+static inline int k15_isStatusBoardProcessAlive( uint32_t processId )
+{
+#if defined( _WIN32 )
+    HANDLE processHandle = OpenProcess( PROCESS_QUERY_LIMITED_INFORMATION, FALSE, ( DWORD )processId );
+    DWORD  exitCode      = 0;
+    int    isAlive       = 0;
+    if ( processHandle == NULL )
+    {
+        /*FK: Can't tell, better not steal the slot*/
+        return GetLastError() != ERROR_INVALID_PARAMETER;
+    }
+
+    isAlive = GetExitCodeProcess( processHandle, &exitCode ) && exitCode == STILL_ACTIVE;
+    CloseHandle( processHandle );
+    return isAlive;
+#else
+    return kill( ( pid_t )processId, 0 ) == 0 || errno != ESRCH;
+#endif
+}
+
+static inline int k15_isStatusBoardSegmentValid( const k15_status_board_segment* pSegment )
+{
+    return k15_loadStatusBoardAcquire( &pSegment->header.magic ) == K15_STATUS_BOARD_MAGIC &&
+           pSegment->header.version == K15_STATUS_BOARD_VERSION &&
+           pSegment->header.slotCount == K15_STATUS_BOARD_SLOT_COUNT &&
+           pSegment->header.slotSizeInBytes == sizeof( k15_status_board_slot );
+}
+
+/*FK: Maps the board and creates it first if createIfMissing is set. Returns 0 on failure*/
+static inline int k15_mapStatusBoard( k15_status_board* pBoard, const char* pName, int createIfMissing )
+{
+    const size_t segmentSizeInBytes = sizeof( k15_status_board_segment );
+    pBoard->pSegment                = NULL;
+
+#if defined( _WIN32 )
+    if ( createIfMissing )
+    {
+        pBoard->mappingHandle = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, ( DWORD )segmentSizeInBytes, pName );
+    }
+    else
+    {
+        pBoard->mappingHandle = OpenFileMappingA( FILE_MAP_ALL_ACCESS, FALSE, pName );
+    }
+
+    if ( pBoard->mappingHandle == NULL )
+    {
+        return 0;
+    }
+
+    pBoard->pSegment = ( k15_status_board_segment* )MapViewOfFile( pBoard->mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, segmentSizeInBytes );
+    if ( pBoard->pSegment == NULL )
+    {
+        CloseHandle( pBoard->mappingHandle );
+        pBoard->mappingHandle = NULL;
+        return 0;
+    }
+#else
+    const int   fileDescriptor = shm_open( pName, createIfMissing ? ( O_RDWR | O_CREAT ) : O_RDWR, 0660 );
+    struct stat fileStat;
+    void*       pMemory = MAP_FAILED;
+    if ( fileDescriptor == -1 )
+    {
+        return 0;
+    }
+
+    if ( fstat( fileDescriptor, &fileStat ) != 0 || ( ( size_t )fileStat.st_size < segmentSizeInBytes && ( !createIfMissing || ftruncate( fileDescriptor, ( off_t )segmentSizeInBytes ) != 0 ) ) )
+    {
+        close( fileDescriptor );
+        return 0;
+    }
+
+    pMemory = mmap( NULL, segmentSizeInBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0 );
+
+    /*FK: The mapping keeps the segment alive, the descriptor isn't needed anymore*/
+    close( fileDescriptor );
+    if ( pMemory == MAP_FAILED )
+    {
+        return 0;
+    }
+
+    pBoard->pSegment = ( k15_status_board_segment* )pMemory;
+#endif
+    return 1;
+}
+
+static inline void k15_closeStatusBoard( k15_status_board* pBoard )
+{
+    if ( pBoard->pSegment == NULL )
+    {
+        return;
+    }
+
+#if defined( _WIN32 )
+    UnmapViewOfFile( pBoard->pSegment );
+    CloseHandle( pBoard->mappingHandle );
+    pBoard->mappingHandle = NULL;
+#else
+    munmap( pBoard->pSegment, sizeof( k15_status_board_segment ) );
+#endif
+    pBoard->pSegment = NULL;
+}
+
+/*FK: Server manager side. An existing board with the same layout is kept, so game servers survive a manager restart.
+      Returns 0 on failure*/
+static inline int k15_createStatusBoard( k15_status_board* pBoard, const char* pName )
+{
+    k15_status_board_segment* pSegment = NULL;
+    if ( !k15_mapStatusBoard( pBoard, pName, 1 ) )
+    {
+        return 0;
+    }
+
+    pSegment = pBoard->pSegment;
+    if ( k15_isStatusBoardSegmentValid( pSegment ) )
+    {
+        return 1;
+    }
+
+    memset( pSegment, 0, sizeof( k15_status_board_segment ) );
+    pSegment->header.version         = K15_STATUS_BOARD_VERSION;
+    pSegment->header.slotCount       = K15_STATUS_BOARD_SLOT_COUNT;
+    pSegment->header.slotSizeInBytes = sizeof( k15_status_board_slot );
+    k15_storeStatusBoardRelease( &pSegment->header.magic, K15_STATUS_BOARD_MAGIC );
+    return 1;
+}
+
+/*FK: Game server side, fails if the server manager didn't create the board yet. Returns 0 on failure*/
+static inline int k15_openStatusBoard( k15_status_board* pBoard, const char* pName )
+{
+    if ( !k15_mapStatusBoard( pBoard, pName, 0 ) )
+    {
+        return 0;
+    }
+
+    if ( !k15_isStatusBoardSegmentValid( pBoard->pSegment ) )
+    {
+        k15_closeStatusBoard( pBoard );
+        return 0;
+    }
+
+    return 1;
+}
+
+static inline void k15_beginStatusBoardSlotUpdate( k15_status_board_slot* pSlot )
+{
+    /*FK: Only the owner writes the slot, so the sequence can't change under our feet*/
+    k15_storeStatusBoardRelaxed( &pSlot->sequence, pSlot->sequence + 1u );
+    k15_releaseStatusBoardFence();
+}
+
+static inline void k15_endStatusBoardSlotUpdate( k15_status_board_slot* pSlot )
+{
+    k15_storeStatusBoardRelease( &pSlot->sequence, pSlot->sequence + 1u );
+}
+
+/*FK: Copies a consistent snapshot of a slot. Returns 0 if the slot is free or its owner is stuck mid-update*/
+static inline int k15_readStatusBoardSlot( const k15_status_board* pBoard, uint32_t slotIndex, k15_status_board_slot* pSnapshot )
+{
+    const k15_status_board_slot* pSlot   = pBoard->pSegment->slots + slotIndex;
+    uint32_t                     attempt = 0u;
+    for ( attempt = 0u; attempt < K15_STATUS_BOARD_READ_RETRIES; ++attempt )
+    {
+        const uint32_t sequenceBefore = k15_loadStatusBoardAcquire( &pSlot->sequence );
+        if ( sequenceBefore & 1u )
+        {
+            k15_pauseStatusBoardReader();
+            continue;
+        }
+
+        memcpy( pSnapshot, ( const void* )pSlot, sizeof( k15_status_board_slot ) );
+        k15_acquireStatusBoardFence();
+
+        if ( k15_loadStatusBoardAcquire( &pSlot->sequence ) == sequenceBefore )
+        {
+            return pSnapshot->ownerProcessId != 0u;
+        }
+
+        k15_pauseStatusBoardReader();
+    }
+
+    return 0;
+}
+
+/*FK: The heartbeat decides, the pid is only a secondary check: a fresh heartbeat keeps the slot even if the pid looks dead
+      (game server in another pid namespace sharing /dev/shm), a heartbeat that's stale for K15_STATUS_BOARD_ABANDONED_MS
+      gives it up even if the pid looks alive (pid got reused)*/
+static inline int k15_isStatusBoardSlotReclaimable( const k15_status_board* pBoard, uint32_t slotIndex, uint32_t owner )
+{
+    const uint64_t        timestampInMs = k15_getStatusBoardTimestampInMs();
+    k15_status_board_slot snapshot;
+    if ( owner == 0u )
+    {
+        return 1;
+    }
+
+    if ( !k15_readStatusBoardSlot( pBoard, slotIndex, &snapshot ) || snapshot.ownerProcessId != owner )
+    {
+        /*FK: Owner is stuck mid-update (or just changed), only take it over if it's gone*/
+        return !k15_isStatusBoardProcessAlive( owner );
+    }
+
+    if ( timestampInMs < snapshot.heartbeatTimestampInMs + K15_STATUS_BOARD_STALE_MS )
+    {
+        return 0;
+    }
+
+    return timestampInMs >= snapshot.heartbeatTimestampInMs + K15_STATUS_BOARD_ABANDONED_MS || !k15_isStatusBoardProcessAlive( owner );
+}
+
+/*FK: Takes a free slot (or one whose owner stopped heartbeating) and publishes name and port. Returns NULL if the board is full*/
+static inline k15_status_board_slot* k15_claimStatusBoardSlot( k15_status_board* pBoard, const char* pName, uint16_t port )
+{
+    const uint32_t processId = k15_getStatusBoardProcessId();
+    uint32_t       slotIndex = 0u;
+    for ( slotIndex = 0u; slotIndex < K15_STATUS_BOARD_SLOT_COUNT; ++slotIndex )
+    {
+        k15_status_board_slot* pSlot         = pBoard->pSegment->slots + slotIndex;
+        const uint32_t         previousOwner = k15_loadStatusBoardAcquire( &pSlot->ownerProcessId );
+        size_t                 nameLength    = 0u;
+        if ( !k15_isStatusBoardSlotReclaimable( pBoard, slotIndex, previousOwner ) )
+        {
+            continue;
+        }
+
+        if ( !k15_compareExchangeStatusBoard( &pSlot->ownerProcessId, previousOwner, processId ) )
+        {
+            continue;
+        }
+
+        /*FK: A previous owner might have left the sequence odd, round it up so readers see a consistent slot again*/
+        k15_storeStatusBoardRelaxed( &pSlot->sequence, ( pSlot->sequence + 1u ) & ~1u );
+
+        nameLength = strlen( pName );
+        nameLength = nameLength < K15_STATUS_BOARD_NAME_LENGTH ? nameLength : K15_STATUS_BOARD_NAME_LENGTH;
+
+        k15_beginStatusBoardSlotUpdate( pSlot );
+        pSlot->state                  = K15_SERVER_STATE_STARTING;
+        pSlot->port                   = port;
+        pSlot->playerCount            = 0u;
+        pSlot->maxPlayerCount         = 0u;
+        pSlot->tickTimeInMicroseconds = 0u;
+        pSlot->heartbeatTimestampInMs = k15_getStatusBoardTimestampInMs();
+        memset( pSlot->name, 0, K15_STATUS_BOARD_NAME_LENGTH );
+        memcpy( pSlot->name, pName, nameLength );
+        k15_endStatusBoardSlotUpdate( pSlot );
+        return pSlot;
+    }
+
+    return NULL;
+}
+
+static inline void k15_releaseStatusBoardSlot( k15_status_board_slot* pSlot )
+{
+    k15_beginStatusBoardSlotUpdate( pSlot );
+    pSlot->state = K15_SERVER_STATE_STOPPING;
+    k15_endStatusBoardSlotUpdate( pSlot );
+
+    k15_storeStatusBoardRelease( &pSlot->ownerProcessId, 0u );
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*K15_STATUS_BOARD_INCLUDE*/